@@ -28,6 +28,17 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, Mate
 
 // render the mesh
 void Mesh::Draw(Shader* shader, glm::vec3 position, glm::vec3 scale, glm::vec3 rotation)
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	model = glm::translate(model, position);
+	model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)); // Pitch
+	model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)); // Yaw
+	model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)); // Roll
+	model = glm::scale(model, scale);
+	Draw(shader, model);
+}
+
+void Mesh::Draw(Shader* shader, const glm::mat4& model)
 {
 	// bind appropriate textures
 	unsigned int diffuseNr	= 1;
@@ -95,12 +106,6 @@ void Mesh::Draw(Shader* shader, glm::vec3 position, glm::vec3 scale, glm::vec3 r
 	}
 	
 
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, position);
-	model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)); // Pitch
-	model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)); // Yaw
-	model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)); // Roll
-	model = glm::scale(model, scale);
 	shader->setMat4("model", model);
 
 	// draw mesh
@@ -64,6 +64,7 @@ public:
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, Material material);
 	// render the mesh
 	void Draw(Shader* shader, glm::vec3 position = glm::vec3(0.0f), glm::vec3 scale = glm::vec3(1.0f), glm::vec3 rotation = glm::vec3(0.0f));
+	void Draw(Shader* shader, const glm::mat4& model); // with a ready made model matrix
 	// initialize all the buffer objects/arrays
 	void setupMesh();
 	//void normalizeMesh();
@@ -21,6 +21,28 @@ void InputENG::Init(std::vector<GameObj*>* gameobjects)
 	}
 }
 
+void InputENG::Init(Registry& registry)
+{
+	managed.clear();
+	registry.Query<Input>().Each([this](Entity, Input& in){ managed.push_back(in.obj); });
+}
+
+void InputENG::Add(InputObj* obj)
+{
+	managed.push_back(obj);
+}
+
+void InputENG::Remove(InputObj* obj)
+{
+	for (unsigned int i = 0; i < managed.size(); i++)
+		if (managed[i] == obj)
+		{
+			managed[i] = managed.back();
+			managed.pop_back();
+			return;
+		}
+}
+
 void InputENG::Update(GLFWwindow* window)
 {
 	for (auto obj : managed)
@@ -2,6 +2,7 @@
 #define INPUT_OBJ_H
 
 #include "gameobj.h"
+#include "ecs.h"
 
 #include <GLFW/glfw3.h>
 #include <iostream>
@@ -24,6 +25,9 @@ public:
 	std::vector<InputObj*> managed;
 
 	void Init(std::vector<GameObj*>*);
+	void Init(Registry&); //objects of the Input components
+	void Add(InputObj*);
+	void Remove(InputObj*); //searched, there are only a few of them
 	void Update(GLFWwindow* window);
 	void Update(GLFWwindow* window, int key, int scancode, int action, int mods);
 
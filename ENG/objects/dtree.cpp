@@ -0,0 +1,267 @@
+#include "dtree.h"
+#include <cmath>
+#include <algorithm>
+
+int AABBTree::Alloc(){
+	if(freeNode<0){
+		nodes.push_back(Node());
+		return nodes.size()-1;
+	}
+	int n = freeNode;
+	freeNode = nodes[n].parent;
+	nodes[n] = Node();
+	return n;
+}
+
+void AABBTree::Free(int n){
+	nodes[n].parent = freeNode;
+	nodes[n].height = -1;
+	freeNode = n;
+}
+
+void AABBTree::Update(int id, glm::dvec2 lo, glm::dvec2 hi){
+	if(id>=(int)boxes.size()) boxes.resize(id+1);
+	if(id>=(int)moved.size()) moved.resize(id+1,false); //never shrinks before Pairs, removed ids are flagged past the boxes
+	Box& b = boxes[id];
+	glm::dvec2 motion = ((lo+hi)-(b.lo+b.hi))*.5;
+	bool in = b.leaf>=0;
+	b.lo = lo;
+	b.hi = hi;
+	if(in){
+		const Node& l = nodes[b.leaf];
+		if(l.lo.x<=lo.x && l.lo.y<=lo.y && hi.x<=l.hi.x && hi.y<=l.hi.y) return; //still in its fat box
+		RemoveLeaf(b.leaf);
+	} else {
+		b.leaf = Alloc();
+		motion = glm::dvec2(0);
+	}
+	//fattened all around, and further where it was going
+	Node& l = nodes[b.leaf];
+	glm::dvec2 margin(fatten*glm::max(hi.x-lo.x,hi.y-lo.y));
+	glm::dvec2 ahead = motion*predict;
+	l.lo = lo-margin+glm::min(ahead,glm::dvec2(0));
+	l.hi = hi+margin+glm::max(ahead,glm::dvec2(0));
+	l.id = id;
+	l.height = 0;
+	l.left = l.right = -1;
+	InsertLeaf(b.leaf);
+	moved[id] = true;
+}
+
+void AABBTree::Remove(int id){
+	if(id<0 || id>=(int)boxes.size() || boxes[id].leaf<0) return;
+	RemoveLeaf(boxes[id].leaf);
+	Free(boxes[id].leaf);
+	boxes[id].leaf = -1;
+	moved[id] = true;
+}
+
+void AABBTree::Truncate(int n){
+	for(int id=n;id<(int)boxes.size();id++) Remove(id);
+	//their couples are dropped by the next Pairs, flags stay until then
+	if(n<(int)boxes.size()) boxes.resize(glm::max(n,0));
+}
+
+void AABBTree::InsertLeaf(int leaf){
+	if(root<0){
+		root = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+	int s = BestSibling(nodes[leaf].lo,nodes[leaf].hi);
+	int oldParent = nodes[s].parent;
+	int p = Alloc();
+	nodes[p].parent = oldParent;
+	nodes[p].left = s;
+	nodes[p].right = leaf;
+	nodes[s].parent = p;
+	nodes[leaf].parent = p;
+	if(oldParent<0) root = p;
+	else if(nodes[oldParent].left==s) nodes[oldParent].left = p;
+	else nodes[oldParent].right = p;
+	for(int i=p;i>=0;i=nodes[i].parent){
+		Refit(i);
+		i = Balance(i);
+	}
+}
+
+int AABBTree::BestSibling(glm::dvec2 lo, glm::dvec2 hi){
+	//branch and bound on the perimeter the insertion adds, every ancestor grows too
+	//a greedy descent goes wrong early when the first boxes are scattered
+	double own = Perimeter(lo,hi);
+	int best = root;
+	double bestCost = Perimeter(glm::min(nodes[root].lo,lo),glm::max(nodes[root].hi,hi));
+	auto later = [](const Candidate& a,const Candidate& b){return a.bound>b.bound;};
+	heap.clear();
+	heap.push_back({root,0.,own});
+	while(!heap.empty()){
+		std::pop_heap(heap.begin(),heap.end(),later);
+		Candidate k = heap.back();
+		heap.pop_back();
+		if(k.bound>=bestCost) break; //smallest bound first, nothing left can do better
+		const Node& n = nodes[k.node];
+		double combined = Perimeter(glm::min(n.lo,lo),glm::max(n.hi,hi));
+		double cost = combined+k.inherited;
+		if(cost<bestCost){
+			best = k.node;
+			bestCost = cost;
+		}
+		if(n.Leaf()) continue;
+		double inherited = k.inherited+combined-Perimeter(n.lo,n.hi);
+		double bound = own+inherited; //below it the new parent is at least the new box
+		if(bound>=bestCost) continue;
+		heap.push_back({n.left,inherited,bound});
+		std::push_heap(heap.begin(),heap.end(),later);
+		heap.push_back({n.right,inherited,bound});
+		std::push_heap(heap.begin(),heap.end(),later);
+	}
+	return best;
+}
+
+void AABBTree::RemoveLeaf(int leaf){
+	if(leaf==root){
+		root = -1;
+		return;
+	}
+	int p = nodes[leaf].parent;
+	int g = nodes[p].parent;
+	int s = (nodes[p].left==leaf)? nodes[p].right : nodes[p].left;
+	nodes[s].parent = g;
+	Free(p);
+	if(g<0){
+		root = s;
+		return;
+	}
+	if(nodes[g].left==p) nodes[g].left = s;
+	else nodes[g].right = s;
+	for(int i=g;i>=0;i=nodes[i].parent){
+		Refit(i);
+		i = Balance(i);
+	}
+}
+
+void AABBTree::Refit(int n){
+	Node& k = nodes[n];
+	const Node& l = nodes[k.left];
+	const Node& r = nodes[k.right];
+	k.lo = glm::min(l.lo,r.lo);
+	k.hi = glm::max(l.hi,r.hi);
+	k.height = 1+glm::max(l.height,r.height);
+}
+
+int AABBTree::Balance(int a){
+	const Node& n = nodes[a];
+	if(n.Leaf() || n.height<2) return a;
+	int balance = nodes[n.right].height-nodes[n.left].height;
+	if(balance>1) return Rotate(a,n.right);
+	if(balance<-1) return Rotate(a,n.left);
+	Swap(a);
+	return a;
+}
+
+int AABBTree::Rotate(int a, int c){
+	//c goes up, a keeps c's shorter child in c's place, c keeps the taller one
+	Node& A = nodes[a];
+	Node& C = nodes[c];
+	int f = C.left, g = C.right;
+	int keep = (nodes[f].height>nodes[g].height)? f : g;
+	int give = (keep==f)? g : f;
+	C.left = a;
+	C.right = keep;
+	C.parent = A.parent;
+	A.parent = c;
+	if(C.parent<0) root = c;
+	else if(nodes[C.parent].left==a) nodes[C.parent].left = c;
+	else nodes[C.parent].right = c;
+	if(A.left==c) A.left = give;
+	else A.right = give;
+	nodes[give].parent = a;
+	Refit(a);
+	Refit(c);
+	return c;
+}
+
+void AABBTree::Swap(int a){
+	//a child of a traded with a grandchild on the other side, when it shrinks that side
+	//the tree keeps the same height, only the boxes under a get tighter
+	const Node& n = nodes[a];
+	int bestChild = -1, bestGrand = -1;
+	double bestGain = 0;
+	for(int side=0;side<2;side++){
+		int b = side? n.right : n.left; //goes down
+		int c = side? n.left : n.right; //loses a child to b's place
+		const Node& C = nodes[c];
+		if(C.Leaf() || nodes[b].height>=nodes[c].height) continue; //would make c's side taller
+		double before = Perimeter(C.lo,C.hi);
+		for(int g=0;g<2;g++){
+			int up = g? C.right : C.left;
+			int stay = g? C.left : C.right;
+			const Node& B = nodes[b];
+			const Node& S = nodes[stay];
+			double gain = before-Perimeter(glm::min(B.lo,S.lo),glm::max(B.hi,S.hi));
+			if(gain>bestGain){
+				bestGain = gain;
+				bestChild = b;
+				bestGrand = up;
+			}
+		}
+	}
+	if(bestChild<0) return;
+	int c = nodes[bestGrand].parent;
+	Node& A = nodes[a];
+	Node& C = nodes[c];
+	if(A.left==bestChild) A.left = bestGrand;
+	else A.right = bestGrand;
+	if(C.left==bestGrand) C.left = bestChild;
+	else C.right = bestChild;
+	nodes[bestGrand].parent = a;
+	nodes[bestChild].parent = c;
+	Refit(c);
+	Refit(a);
+}
+
+void AABBTree::Pairs(std::vector<std::pair<int,int>>& out){
+	//couples of fat boxes are kept between calls, only the ones of moved leaves are looked for again
+	int n = 0;
+	for(auto& c : pairs)
+		if(!moved[c.first] && !moved[c.second]) pairs[n++] = c;
+	pairs.resize(n);
+	for(int id=0;id<(int)moved.size();id++){
+		if(!moved[id] || id>=(int)boxes.size() || boxes[id].leaf<0) continue;
+		const Node& l = nodes[boxes[id].leaf];
+		Overlapping(l.lo,l.hi,[this,id](int other){
+			if(other==id || (moved[other] && other<id)) return; //found from the lower one
+			pairs.push_back(std::make_pair(glm::min(id,other),glm::max(id,other)));
+		});
+	}
+	moved.assign(boxes.size(),false);
+	//fat boxes meeting aren't enough, the ones given to Update have to
+	out.clear();
+	for(auto& c : pairs){
+		const Box& a = boxes[c.first];
+		const Box& b = boxes[c.second];
+		if(Overlap(a.lo,a.hi,b.lo,b.hi)) out.push_back(c);
+	}
+}
+
+double AABBTree::BoxDistance(glm::dvec2 p, glm::dvec2 lo, glm::dvec2 hi){
+	glm::dvec2 d = glm::max(glm::max(lo-p,p-hi),glm::dvec2(0));
+	return glm::length(d);
+}
+
+bool AABBTree::RayBox(glm::dvec2 from, glm::dvec2 inv, double maxT, glm::dvec2 lo, glm::dvec2 hi){
+	double t0 = 0, t1 = maxT;
+	for(int a=0;a<2;a++){
+		if(std::isinf(inv[a])){ //parallel to this slab
+			if(from[a]<lo[a] || from[a]>hi[a]) return false;
+			continue;
+		}
+		double tn = (lo[a]-from[a])*inv[a];
+		double tf = (hi[a]-from[a])*inv[a];
+		if(tn>tf) std::swap(tn,tf);
+		t0 = glm::max(t0,tn);
+		t1 = glm::min(t1,tf);
+		if(t0>t1) return false;
+	}
+	return true;
+}
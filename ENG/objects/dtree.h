@@ -0,0 +1,151 @@
+#pragma once
+#include "ENG/includes/glm/glm.hpp"
+#include <vector>
+#include <utility>
+
+/**
+Dynamic AABB tree broad phase
+leaves hold fattened boxes, an object whose box stays inside its fat box isn't touched
+others are taken out and put back where they grow the tree the least, rotations keep it balanced
+no cell size, so it suits bodies of very different sizes spread without bounds
+**/
+class AABBTree {
+public:
+	double fatten = .1; //margin added around boxes, in box widths
+	double predict = 2.; //boxes are stretched this many times their last motion ahead
+
+	void Update(int id, glm::dvec2 lo, glm::dvec2 hi); //inserts, or moves if it left its fat box; ids are indices, keep them dense
+	void Remove(int id);
+	void Truncate(int n); //removes ids from n on
+	void Pairs(std::vector<std::pair<int,int>>& out); //every overlapping couple once, lower id first, call it after each round of Updates
+	int Height() const {return (root<0)? 0 : nodes[root].height;}
+
+	//queries, on the boxes given to the last Update; the traversal stack is shared, don't query from a callback
+	template <typename F> void Query(glm::dvec2 lo, glm::dvec2 hi, F f); //f(id) for every box overlapping, stops when f returns false
+	//boxes crossed by the segment from-to, f(id,t) returns the fraction of the segment to keep searching (0 stops)
+	template <typename F> void Raycast(glm::dvec2 from, glm::dvec2 to, F f);
+	//boxes nearest to p first, f(id,bound) returns the distance past which nothing more is wanted
+	template <typename F> void Nearest(glm::dvec2 p, double bound, F f);
+
+//private:
+	struct Node {
+		glm::dvec2 lo,hi; //fat for leaves, around both children otherwise
+		int parent = -1; //next free node once freed
+		int left = -1, right = -1; //leaves have none
+		int height = 0; //leaves are 0
+		int id = -1; //leaves only
+		bool Leaf() const {return left<0;}
+	};
+	struct Box {
+		glm::dvec2 lo,hi;
+		int leaf = -1;
+	};
+	std::vector<Node> nodes;
+	std::vector<Box> boxes; //by id
+	std::vector<int> stack;
+	std::vector<std::pair<int,int>> pairs; //fat boxes overlapping, kept between Pairs calls
+	std::vector<char> moved; //by id, (re)inserted or removed since the last Pairs
+	struct Candidate {
+		int node;
+		double inherited; //growth of its ancestors
+		double bound; //least an insertion below it costs
+	};
+	std::vector<Candidate> heap; //BestSibling's
+	int root = -1;
+	int freeNode = -1;
+
+	int Alloc();
+	void Free(int n);
+	void InsertLeaf(int leaf);
+	int BestSibling(glm::dvec2 lo, glm::dvec2 hi); //where the box adds the least perimeter
+	void RemoveLeaf(int leaf);
+	void Refit(int n); //box and height from the children
+	int Balance(int n); //returns the node now in its place
+	int Rotate(int a, int c); //c, child of a, takes its place, when one side is too tall
+	void Swap(int a); //otherwise trades a child and a grandchild if it shrinks the boxes
+	template <typename F> void Overlapping(glm::dvec2 lo, glm::dvec2 hi, F f); //leaves by their fat box
+	static double Perimeter(glm::dvec2 lo, glm::dvec2 hi) {return 2.*((hi.x-lo.x)+(hi.y-lo.y));}
+	static bool Overlap(glm::dvec2 alo, glm::dvec2 ahi, glm::dvec2 blo, glm::dvec2 bhi){
+		return !(ahi.x<blo.x || bhi.x<alo.x || ahi.y<blo.y || bhi.y<alo.y);
+	}
+	static double BoxDistance(glm::dvec2 p, glm::dvec2 lo, glm::dvec2 hi); //0 inside
+	static bool RayBox(glm::dvec2 from, glm::dvec2 inv, double maxT, glm::dvec2 lo, glm::dvec2 hi); //slabs, inv is 1/(to-from)
+};
+
+template <typename F> void AABBTree::Query(glm::dvec2 lo, glm::dvec2 hi, F f){
+	if(root<0) return;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()){
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if(!Overlap(lo,hi,n.lo,n.hi)) continue;
+		if(n.Leaf()){
+			const Box& b = boxes[n.id];
+			if(Overlap(lo,hi,b.lo,b.hi) && !f(n.id)) return;
+			continue;
+		}
+		stack.push_back(n.left);
+		stack.push_back(n.right);
+	}
+}
+
+template <typename F> void AABBTree::Overlapping(glm::dvec2 lo, glm::dvec2 hi, F f){
+	if(root<0) return;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()){
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if(!Overlap(lo,hi,n.lo,n.hi)) continue;
+		if(n.Leaf()) f(n.id);
+		else {
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
+template <typename F> void AABBTree::Raycast(glm::dvec2 from, glm::dvec2 to, F f){
+	if(root<0) return;
+	glm::dvec2 d = to-from;
+	glm::dvec2 inv(1./d.x,1./d.y); //infinite on axis aligned rays, the slabs handle it
+	double maxT = 1.;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()){
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if(!RayBox(from,inv,maxT,n.lo,n.hi)) continue;
+		if(n.Leaf()){
+			const Box& b = boxes[n.id];
+			if(!RayBox(from,inv,maxT,b.lo,b.hi)) continue;
+			maxT = glm::min(maxT,(double)f(n.id,maxT));
+			if(maxT<=0) return;
+			continue;
+		}
+		stack.push_back(n.left);
+		stack.push_back(n.right);
+	}
+}
+
+template <typename F> void AABBTree::Nearest(glm::dvec2 p, double bound, F f){
+	if(root<0) return;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()){
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+		if(BoxDistance(p,n.lo,n.hi)>bound) continue;
+		if(n.Leaf()){
+			const Box& b = boxes[n.id];
+			if(BoxDistance(p,b.lo,b.hi)<=bound) bound = glm::min(bound,(double)f(n.id,bound));
+			continue;
+		}
+		//the nearer child is popped first so the bound shrinks early
+		bool leftFirst = BoxDistance(p,nodes[n.left].lo,nodes[n.left].hi)<=BoxDistance(p,nodes[n.right].lo,nodes[n.right].hi);
+		int l = n.left, r = n.right;
+		stack.push_back(leftFirst? r : l);
+		stack.push_back(leftFirst? l : r);
+	}
+}
@@ -0,0 +1,24 @@
+#include "ecs.h"
+
+int Registry::NextTypeId(){
+	static int next = 0;
+	return next++;
+}
+
+Entity Registry::Create(){
+	if(!freeIds.empty()){
+		Entity e = freeIds.back();
+		freeIds.pop_back();
+		alive[e] = true;
+		return e;
+	}
+	alive.push_back(true);
+	return alive.size()-1;
+}
+
+void Registry::Destroy(Entity e){
+	if(!Alive(e)) return;
+	for(auto& p : pools) if(p) p->Remove(e);
+	alive[e] = false;
+	freeIds.push_back(e);
+}
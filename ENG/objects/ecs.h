@@ -0,0 +1,173 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <algorithm>
+
+#include "ENG/includes/glm/glm.hpp"
+
+class GameObj;
+class PhyxObj2D;
+class CollisionObj;
+class RenderObj;
+class InputObj;
+
+typedef int Entity;
+
+/**
+Components
+Transform holds the state the transform system reads, RigidBody2D where its state is in the physics store
+the others point the engines at their objects, so nothing casts every GameObj
+**/
+struct Transform {
+	GameObj * obj;
+	Entity parent = -1; //registered parent, ordered before its children by Game::UpdateTransforms
+	int depth = 0; //parents above it, set when the pool is ordered
+	//local state, GameObj's setters write it through
+	glm::dvec3 position = glm::dvec3(0);
+	glm::dvec3 rotation = glm::dvec3(0); //pitch / yaw / roll, in degrees
+	glm::dvec3 scale = glm::dvec3(1);
+	glm::dvec3 previous = glm::dvec3(0); //position before the last physics step
+	bool interpolated = false;
+	//drawing state, composed once per frame
+	glm::dvec3 drawPosition = glm::dvec3(0); //interpolated world position
+	glm::mat4 orientation = glm::mat4(1.0f); //parents' rotations then its own
+	glm::mat4 worldMatrix = glm::mat4(1.0f); //model matrix the renderer uses
+};
+struct RigidBody2D {
+	PhyxObj2D * body;
+	int index = -1; //in PhyxENG::bodies, kept by the engine as bodies move in the store
+};
+struct Collidable	{ CollisionObj * obj; }; //Collider is the shape class already
+struct Renderable	{ RenderObj * obj; };
+struct Input		{ InputObj * obj; };
+
+class PoolBase {
+public:
+	virtual ~PoolBase()=default;
+	virtual void Remove(Entity)=0;
+	virtual bool Has(Entity) const=0;
+	virtual int Size() const=0;
+};
+
+/**
+Component pool, a sparse set
+components are packed in dense, sparse maps an entity to its slot
+removing moves the last component in the hole, so the order isn't kept
+**/
+template <typename T>
+class Pool : public PoolBase {
+public:
+	std::vector<T> dense;
+	std::vector<Entity> entities; //owner of each dense slot
+	std::vector<int> sparse; //slot of each entity, -1 if it has none
+
+	T& Add(Entity e, const T& c){
+		if(e>=(int)sparse.size()) sparse.resize(e+1,-1);
+		if(sparse[e]>=0) return dense[sparse[e]] = c;
+		sparse[e] = dense.size();
+		dense.push_back(c);
+		entities.push_back(e);
+		return dense.back();
+	}
+	void Remove(Entity e) override {
+		if(!Has(e)) return;
+		int i = sparse[e];
+		dense[i] = dense.back();
+		entities[i] = entities.back();
+		sparse[entities[i]] = i;
+		dense.pop_back();
+		entities.pop_back();
+		sparse[e] = -1;
+	}
+	bool Has(Entity e) const override {return e>=0 && e<(int)sparse.size() && sparse[e]>=0;}
+	int Size() const override {return dense.size();}
+	T& Get(Entity e) {return dense[sparse[e]];}
+	template <typename C> void Sort(C less){ //reorders the components, stable, their entities follow
+		std::vector<int> order(dense.size());
+		for(int i=0;i<(int)order.size();i++) order[i] = i;
+		std::stable_sort(order.begin(),order.end(),[&](int a,int b){return less(dense[a],dense[b]);});
+		std::vector<T> d;
+		std::vector<Entity> e;
+		d.reserve(dense.size());
+		e.reserve(entities.size());
+		for(int i : order){
+			d.push_back(dense[i]);
+			e.push_back(entities[i]);
+		}
+		dense.swap(d);
+		entities.swap(e);
+		for(int i=0;i<(int)entities.size();i++) sparse[entities[i]] = i;
+	}
+};
+
+/**
+Entities having all of T..., walked along the smallest of their pools
+don't add or remove components of these types while walking
+**/
+template <typename... T>
+class View {
+public:
+	View(Pool<T>&... p): pools(&p...) {}
+
+	template <typename F>
+	void Each(F fn){ //fn(Entity, T&...)
+		PoolBase* lead = Smallest();
+		const std::vector<Entity>& ids = Entities(lead);
+		for(int i=0;i<(int)ids.size();i++){
+			Entity e = ids[i];
+			if((std::get<Pool<T>*>(pools)->Has(e) && ...))
+				fn(e,std::get<Pool<T>*>(pools)->Get(e)...);
+		}
+	}
+	int SizeHint() {return Smallest()->Size();}
+
+//private:
+	std::tuple<Pool<T>*...> pools;
+
+	PoolBase* Smallest(){
+		PoolBase* lead = nullptr;
+		((lead = (!lead || std::get<Pool<T>*>(pools)->Size()<lead->Size())? std::get<Pool<T>*>(pools) : lead), ...);
+		return lead;
+	}
+	const std::vector<Entity>& Entities(PoolBase* lead){
+		const std::vector<Entity>* out = nullptr;
+		((out = (lead==std::get<Pool<T>*>(pools))? &std::get<Pool<T>*>(pools)->entities : out), ...);
+		return *out;
+	}
+};
+
+/**
+Registry
+hands out entities and owns one pool per component type
+**/
+class Registry {
+public:
+	Entity Create(); //reuses destroyed ids
+	void Destroy(Entity); //drops every component of it
+	bool Alive(Entity e) const {return e>=0 && e<(int)alive.size() && alive[e];}
+	int Count() const {return alive.size()-freeIds.size();}
+
+	template <typename T> Pool<T>& Components(){
+		int id = TypeId<T>();
+		if(id>=(int)pools.size()) pools.resize(id+1);
+		if(!pools[id]) pools[id].reset(new Pool<T>());
+		return *static_cast<Pool<T>*>(pools[id].get());
+	}
+	template <typename T> T& Add(Entity e, const T& c) {return Components<T>().Add(e,c);}
+	template <typename T> void Remove(Entity e) {Components<T>().Remove(e);}
+	template <typename T> bool Has(Entity e) {return Components<T>().Has(e);}
+	template <typename T> T& Get(Entity e) {return Components<T>().Get(e);}
+	template <typename... T> View<T...> Query() {return View<T...>(Components<T>()...);}
+
+//private:
+	std::vector<std::unique_ptr<PoolBase>> pools; //by TypeId
+	std::vector<char> alive;
+	std::vector<Entity> freeIds;
+
+	static int NextTypeId();
+	template <typename T> static int TypeId(){
+		static int id = NextTypeId();
+		return id;
+	}
+};
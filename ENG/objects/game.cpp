@@ -75,13 +75,147 @@ GLFWwindow* Game::Initialize()
 
 	glfwSetWindowUserPointer(window, this);
 
-	this->collENG.Init(&gameobjects);
-	this->inputENG.Init(&gameobjects);
-	this->phyxENG.Init(&gameobjects,&collENG, &soundENG);
+	this->collENG.jobs = &jobs;
+	this->phyxENG.jobs = &jobs;
+	for (auto go : gameobjects) Register(go);
+	this->collENG.Init(registry);
+	this->inputENG.Init(registry);
+	this->phyxENG.Init(registry,&collENG, &soundENG);
 	return window;
 }
 
 
+Entity Game::Register(GameObj* go)
+{
+	// the only casts, the engines read the pools afterwards
+	if (go->entity >= 0) return go->entity;
+	Entity e = registry.Create();
+	go->entity = e;
+	Transform t;
+	t.obj = go;
+	t.parent = (go->parent) ? go->parent->entity : -1;
+	t.position = go->position;
+	t.rotation = go->rotation;
+	t.scale = go->scale;
+	t.previous = go->previousPosition;
+	t.interpolated = go->interpolated;
+	registry.Add(e, t);
+	go->transforms = &registry.Components<Transform>();
+	for (auto c : go->children) // registered before their parent
+		if (c->transforms) c->transform()->parent = e;
+	if (auto p = dynamic_cast<PhyxObj2D*>(go)) registry.Add(e, RigidBody2D{p});
+	if (auto c = dynamic_cast<CollisionObj*>(go)) registry.Add(e, Collidable{c});
+	if (auto r = dynamic_cast<RenderObj*>(go)) registry.Add(e, Renderable{r});
+	if (auto i = dynamic_cast<InputObj*>(go)) registry.Add(e, Input{i});
+	return e;
+}
+
+Entity Game::Spawn(GameObj* go)
+{
+	// handed to the engines right away, it takes part from their next updates
+	if (go->entity >= 0) return go->entity;
+	go->life = LIFE_ACTIVE;
+	Entity e = Register(go);
+	if (registry.Has<Collidable>(e)) collENG.Add(registry.Get<Collidable>(e).obj);
+	if (registry.Has<RigidBody2D>(e)) phyxENG.Add(registry.Get<RigidBody2D>(e).body);
+	if (registry.Has<Input>(e)) inputENG.Add(registry.Get<Input>(e).obj);
+	return e;
+}
+
+void Game::Despawn(GameObj* go)
+{
+	// the engines may still be reading it this frame, it goes away in EndFrame
+	if (go->entity < 0 || go->life != LIFE_ACTIVE) return; // not spawned, or despawned already
+	go->life = LIFE_PENDING_DESTROY;
+	despawned.push_back(go);
+}
+
+void Game::EndFrame()
+{
+	for (auto go : despawned)
+	{
+		Entity e = go->entity;
+		if (e < 0) continue; // despawned twice
+		if (registry.Has<RigidBody2D>(e)) phyxENG.Remove(registry.Get<RigidBody2D>(e).body);
+		if (registry.Has<Collidable>(e))
+		{
+			CollisionObj* c = registry.Get<Collidable>(e).obj;
+			int id = c->collId;
+			CollisionObj* moved = collENG.Remove(c); // the last object now has its collId
+			phyxENG.Relink(collENG.managed.size(), nullptr);
+			if (moved)
+			{
+				Entity m = moved->entity;
+				phyxENG.Relink(id, registry.Has<RigidBody2D>(m) ? registry.Get<RigidBody2D>(m).body : nullptr);
+			}
+		}
+		if (registry.Has<Input>(e)) inputENG.Remove(registry.Get<Input>(e).obj);
+		for (auto c : go->children) // its entity may come back as another object
+			if (c->transforms) c->transform()->parent = -1;
+		registry.Destroy(e);
+		go->transforms = nullptr;
+		go->entity = -1;
+		go->life = LIFE_RECYCLED;
+	}
+	if (!despawned.empty()) // the scene list only keeps what's in the engines
+		gameobjects.erase(std::remove_if(gameobjects.begin(), gameobjects.end(), [](GameObj* go) { return go->life == LIFE_RECYCLED; }), gameobjects.end());
+	despawned.clear();
+}
+
+void Game::ClearLevel()
+{
+	// out of the engines and the scene first, then the arena frees the objects with their colliders and meshes
+	for (auto& t : registry.Components<Transform>().dense)
+		if (t.obj->arena == &level) Despawn(t.obj);
+	EndFrame();
+	gameobjects.erase(std::remove_if(gameobjects.begin(), gameobjects.end(), [this](GameObj* go) { return go->arena == &level; }), gameobjects.end());
+	level.Clear();
+}
+
+void Game::UpdateTransforms()
+{
+	// a single pass over the Transform pool, parents are kept before their children
+	// offsets add up like worldPosition so drawing and physics agree, rotations compose,
+	// scale is the object's own (a child isn't shrunk with its parent's model)
+	Pool<Transform>& pool = registry.Components<Transform>();
+	OrderTransforms(pool);
+	double alpha = phyxENG.alpha;
+	for (auto& t : pool.dense)
+	{
+		t.drawPosition = t.interpolated ? glm::mix(t.previous, t.position, alpha) : t.position;
+		t.orientation = glm::mat4(1.0f);
+		t.orientation = glm::rotate(t.orientation, (float)glm::radians(t.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)); // Pitch
+		t.orientation = glm::rotate(t.orientation, (float)glm::radians(t.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)); // Yaw
+		t.orientation = glm::rotate(t.orientation, (float)glm::radians(t.rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)); // Roll
+		if (t.parent >= 0)
+		{
+			const Transform& p = pool.Get(t.parent);
+			t.drawPosition += p.drawPosition;
+			t.orientation = p.orientation * t.orientation;
+		}
+		t.worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(t.drawPosition)) * t.orientation;
+		t.worldMatrix = glm::scale(t.worldMatrix, glm::vec3(t.scale));
+	}
+}
+
+void Game::OrderTransforms(Pool<Transform>& pool)
+{
+	// only sorts when a parent comes after one of its children, attaching or spawning does that
+	bool ordered = true;
+	for (int i = 0; i < pool.Size() && ordered; i++)
+	{
+		Entity p = pool.dense[i].parent;
+		ordered = (p < 0 || (pool.Has(p) && pool.sparse[p] < i));
+	}
+	if (ordered) return;
+	for (auto& t : pool.dense)
+	{
+		if (t.parent >= 0 && !pool.Has(t.parent)) t.parent = -1;
+		t.depth = 0;
+		for (Entity p = t.parent; p >= 0; p = pool.Get(p).parent) t.depth++;
+	}
+	pool.Sort([](const Transform& a, const Transform& b) { return a.depth < b.depth; });
+}
 
 void Game::phyxGui()
 {
@@ -91,6 +225,8 @@ void Game::phyxGui()
 	ImGui::NewFrame();
 	ImGui::Begin("driftEngine", 0, ImGuiWindowFlags_AlwaysAutoResize);
 	ImGui::Text("Phyx/s: %f",phyxENG.fps);
+	ImGui::Text("Collision pairs culled: %ld/%ld",collENG.pairsCulled,collENG.pairsTotal);
+	ImGui::Text("Active bodies: %d/%d",phyxENG.active,(int)phyxENG.managed.size());
 	static bool showPhyxSettings = false;
 	if (ImGui::Button("Show Phyx Settings")) showPhyxSettings = !showPhyxSettings;
 
@@ -108,6 +244,13 @@ void Game::phyxGui()
 		ImGui::SameLine();
 		if (ImGui::Button("pause")) phyxENG.timescale = 0;
 
+		ImGui::Text("%s (alpha %.2f)",((phyxENG.fixedstep)? "fixed step":"frame step"),phyxENG.alpha);
+		if (ImGui::Button("toggle fixed step")) phyxENG.fixedstep = !phyxENG.fixedstep;
+		static double step = phyxENG.step;
+		ImGui::InputDouble("##step", &step, 0.001f, 0.01f, "%.4f");
+		if (ImGui::Button("Set step length") && step>0) phyxENG.step = step;
+		ImGui::InputInt("max substeps", &phyxENG.maxSubsteps);
+
 		static float ggravity = phyxENG.G;
 		ImGui::InputFloat("G", &ggravity, 0.01f, 1.0f, "%.8f");
 		if (ImGui::Button("Set G constant")) phyxENG.G = ggravity;
@@ -120,6 +263,32 @@ void Game::phyxGui()
 		ImGui::Text("%s",((phyxENG.clipping)? "clip":"noclip"));
 		if (ImGui::Button("toggle collisions")) phyxENG.clipping = !phyxENG.clipping;
 
+		ImGui::Text("%d contacts, %s",(int)phyxENG.contacts.size(),((phyxENG.warmStarting)? "warm started":"cold started"));
+		if (ImGui::Button("toggle warm starting")) phyxENG.warmStarting = !phyxENG.warmStarting;
+		ImGui::InputInt("solver iterations", &phyxENG.solverIterations);
+		ImGui::Text("%s",((phyxENG.ccd)? "fast bodies swept":"no sweeping"));
+		if (ImGui::Button("toggle continuous collisions")) phyxENG.ccd = !phyxENG.ccd;
+
+		ImGui::Text("%s",((phyxENG.sleeping)? "resting bodies sleep":"no sleeping"));
+		if (ImGui::Button("toggle sleeping")) phyxENG.sleeping = !phyxENG.sleeping;
+
+		static const char* broadphases[] = {"brute force","grid","aabb tree"};
+		ImGui::Text("%s broad phase",broadphases[collENG.broadphase]);
+		if (ImGui::Button("next broad phase"))
+			collENG.broadphase = (BroadPhase)((collENG.broadphase+1)%3);
+
+		ImGui::Text("%s (%s kernel)",((phyxENG.gravitysolver == BarnesHut)? "barnes-hut gravity":"pairwise gravity"),SimdName(phyxENG.simd));
+		if (ImGui::Button("toggle gravity solver"))
+			phyxENG.gravitysolver = (phyxENG.gravitysolver == BarnesHut)? Pairwise : BarnesHut;
+		static double theta = phyxENG.theta;
+		ImGui::InputDouble("##theta", &theta, 0.05f, 0.1f, "%.2f");
+		if (ImGui::Button("Set barnes-hut theta")) phyxENG.theta = theta;
+
+		static const char* integrators[] = {"semi-implicit euler","velocity verlet","runge-kutta 4"};
+		ImGui::Text("%s integrator",integrators[phyxENG.integrator]);
+		if (ImGui::Button("next integrator"))
+			phyxENG.integrator = (Integrator)((phyxENG.integrator+1)%3);
+
 		ImGui::End();
 	}
 
@@ -143,8 +312,8 @@ void Game::phyxGui()
 			x*=-1.; y*=-1.; xv*=-1.; yv*=-1.;
 		}
 		PhyxObjscntr=0;
-		for(auto go : gameobjects){
-			auto po = dynamic_cast<PhyxObj2D*>(go);
+		for(auto& rb : registry.Components<RigidBody2D>().dense){
+			auto po = rb.body;
 			if(po && (PhyxObjscntr++<maxPhyxObjs)) {
 				ImGui::PushID(po);
 				ImGui::Text(po->name.c_str());
@@ -161,8 +330,8 @@ void Game::phyxGui()
 					po->XV(xv);
 					po->YV(yv);
 					po->Mass(m);
-					po->scale=glm::dvec3(s);
-					po->colliders[0]->scale=glm::dvec3(s);
+					po->Scale(glm::dvec3(s));
+					po->UpdateCollider(po->colliders[0]->position, po->colliders[0]->layer, s, 0);
 				}
 				ImGui::PopID();
 			}
@@ -171,15 +340,17 @@ void Game::phyxGui()
 	}
 
 	PhyxObjscntr=0;
-	if(showPhyxObj) for(auto go : gameobjects) {
-		auto po = dynamic_cast<PhyxObj2D*>(go);
-		if(po &&(PhyxObjscntr++<maxPhyxObjs)){
+	RigidBodies& b = phyxENG.bodies;
+	if(showPhyxObj) for(auto& rb : registry.Components<RigidBody2D>().dense) {
+		auto po = rb.body;
+		if(po && rb.index>=0 && (PhyxObjscntr++<maxPhyxObjs)){ // straight from the store, positions as of the last Gather
+			int i = rb.index;
 			ImGui::Begin(po->name.c_str(), 0, ImGuiWindowFlags_AlwaysAutoResize);
 		//	static char str1[128] = "";
 		//	ImGui::InputTextWithHint("input text (w/ hint)", "enter text here", str1, IM_ARRAYSIZE(str1));
-			ImGui::Text("Mass:%f", po->Mass());
-			ImGui::Text("Position X:%.2f\tY:%.2f", po->X(),po->Y());
-			ImGui::Text("Vitesse X:%.2f\tY:%.2f", po->XV(),po->YV());
+			ImGui::Text("Mass:%f", b.mass[i]);
+			ImGui::Text("Position X:%.2f\tY:%.2f", b.x[i],b.y[i]);
+			ImGui::Text("Vitesse X:%.2f\tY:%.2f", b.vx[i],b.vy[i]);
 //			ImGui::InputDouble("input double", &d0, 0.01f, 1.0f, "%.8f");
 //			if (ImGui::Button("Set A")) po->Mass(d0);
 
@@ -226,9 +397,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 //		game->soundENG.Play(1,0);
 		if (game->cameraMode == FREECAM_MODE)
 		{
-			for (auto go : game->gameobjects)
+			for (auto& t : game->registry.Components<Transform>().dense)
 			{
-				Player* cast = dynamic_cast<Player*>(go);
+				Player* cast = dynamic_cast<Player*>(t.obj);
 				if(cast) { game->currentCamera = &cast->camera; break; }
 			}
 			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
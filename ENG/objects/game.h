@@ -24,6 +24,9 @@
 #include "ENG/objects/ctrl.h"
 #include "ENG/objects/rndr.h"
 #include "ENG/objects/sound.h"
+#include "ENG/objects/jobs.h"
+#include "ENG/objects/ecs.h"
+#include "ENG/objects/pool.h"
 
 #include "ENG/shaders/shader.h"
 
@@ -44,7 +47,10 @@ enum CameraMode
 class Game
 {
 public:
-	std::vector<GameObj*> gameobjects;
+	std::vector<GameObj*> gameobjects; // scene registered by Initialize, use Spawn afterwards
+	Registry registry; // components of the registered objects, the Transforms are the live objects
+	std::vector<GameObj*> despawned; // until EndFrame
+	Arena level; // owns the objects of the current level, see ClearLevel
 
 	// Camera
 	Camera* currentCamera;
@@ -65,6 +71,7 @@ public:
 	bool firstMouse;
 
 	// Engines
+	JobSystem jobs; // worker threads shared by the engines
 	RenderENG rndrENG;
 	CollisionENG collENG;
 	PhyxENG phyxENG;
@@ -81,6 +88,13 @@ public:
 
 	Game(unsigned int width, unsigned int height, std::string tPath, std::string mPath, std::string sPath);
 	GLFWwindow* Initialize();
+	Entity Register(GameObj* go); // gives it the components matching its classes
+	Entity Spawn(GameObj* go); // registers it with the engines, between engine updates
+	void Despawn(GameObj* go); // pending destroy until EndFrame, the object stays the caller's
+	void EndFrame(); // unregisters the despawned objects and marks them recycled, last thing of the frame
+	void ClearLevel(); // unregisters and frees everything the level arena made, in one go
+	void UpdateTransforms(); // composes the drawing matrices, after the engines updates
+	void OrderTransforms(Pool<Transform>&); // parents before their children in the pool
 	void phyxGui();
 	void Terminate();
 };
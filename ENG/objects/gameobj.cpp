@@ -15,4 +15,6 @@ void GameObj::attach(GameObj* go, glm::vec3 offset)
 {
 	this->parent = go;
 	go->children.push_back(this);
-}
\ No newline at end of file
+	if (transforms) transform()->parent = go->entity; // -1 until the parent is registered too
+	Dirty();
+}
@@ -7,6 +7,7 @@
 
 #include "ENG/includes/glm/glm.hpp"
 #include "ENG/includes/glm/gtc/matrix_transform.hpp"
+#include "ecs.h"
 #if 0
 	#include <iostream>
 	#define TAB <<"\t"<<
@@ -16,6 +17,16 @@
 	#define TESTLOG(X)
 #endif
 
+class Arena;
+
+// where an object is in its life, Game::Despawn and Game::EndFrame move it along
+enum Lifecycle
+{
+	LIFE_ACTIVE, // in the engines
+	LIFE_PENDING_DESTROY, // despawned, still in the engines until the end of the frame
+	LIFE_RECYCLED // out of every engine, its owner may free or reuse it
+};
+
 class GameObj
 {
 public:
@@ -23,52 +34,95 @@ public:
 	GameObj * parent;
 
 	std::string name;
-	// Transformation variables
+	int entity = -1; // in the Game registry, -1 until registered
+	Pool<Transform> * transforms = nullptr; // the registry's once registered, the setters below write through to it
+	Transform * transform(){ return transforms? &transforms->Get(entity) : nullptr; }
+	Lifecycle life = LIFE_ACTIVE;
+	Arena * arena = nullptr; // owner when it was made by a level Arena, its parts come from it too
+	// Transformation variables, write them with the setters once the object is registered
 	glm::dvec3 position;
 	glm::dvec3 scale;
 	glm::dvec3 rotation; // Picth / Yaw / Roll
+	// position before the last physics step, blended with position when drawing
+	glm::dvec3 previousPosition;
+	bool interpolated = false;
+
+	// world position, cached until Dirty() is called on this object or a parent
+	glm::dvec3 world;
+	bool dirty = true;
+	void Dirty(){
+		if(dirty) return; // children of a dirty object are dirty already
+		dirty = true;
+		for(auto c : children) c->Dirty();
+	}
+	void Position(glm::dvec3 pos){ // local position, unlike MoveTo it doesn't go up to the parent
+		position = pos;
+		if(transforms) transform()->position = pos;
+		Dirty();
+	}
+	void Rotation(glm::dvec3 r){
+		rotation = r;
+		if(transforms) transform()->rotation = r;
+	}
+	void Scale(glm::dvec3 s){
+		scale = s;
+		if(transforms) transform()->scale = s;
+	}
+	void Previous(glm::dvec3 pos, bool blend){ // where the drawing blends from, blend off draws at position
+		previousPosition = pos;
+		interpolated = blend;
+		if(transforms){
+			Transform * t = transform();
+			t->previous = pos;
+			t->interpolated = blend;
+		}
+	}
 
 	glm::dvec3 worldPosition(){
-		glm::dvec3 out = position;
-		if(parent) out += parent->worldPosition();
-		return out;
+		if(dirty){
+			world = position;
+			if(parent) world += parent->worldPosition();
+			dirty = false;
+		}
+		return world;
 	};
 	glm::vec3 worldPositionf(){
-		glm::vec3 out = position;
-		if(parent) out += parent->worldPositionf();
-		return out;
+		return worldPosition();
 	};
 	glm::dvec2 worldPosition2D(){
-		glm::dvec2 out = glm::dvec2(position.x,position.z);
-		if(parent) out += parent->worldPosition2D();
-		return out;
+		glm::dvec3 w = worldPosition();
+		return glm::dvec2(w.x,w.z);
 	};
 	void Move(glm::dvec2 delta){
 		if(parent) parent->Move(delta);
-		else position += glm::dvec3(delta.x,0,delta.y);
+		else Position(position + glm::dvec3(delta.x,0,delta.y));
 	}
 	void Move(glm::dvec3 delta){
 		if(parent) parent->Move(delta);
-		else position += delta;
+		else Position(position + glm::dvec3(delta));
 	}
 	void Move(glm::vec3 delta){
 		if(parent) parent->Move(delta);
-		else position += delta;
+		else Position(position + glm::dvec3(delta));
 	}
 	void MoveTo(glm::vec3 pos){
 		if(parent) parent->MoveTo(pos);
-		else position = pos;
+		else { // teleports are not blended
+			Previous(pos, interpolated);
+			Position(pos);
+		}
 	}
 	void MoveTo(glm::dvec2 pos){
 		if(parent) parent->MoveTo(pos);
-		else position = glm::dvec3(pos.x,0,pos.y);
+		else {
+			Previous(glm::dvec3(pos.x,0,pos.y), interpolated);
+			Position(glm::dvec3(pos.x,0,pos.y));
+		}
 	}
 
-	glm::dvec3 worldRotation(){
-		glm::dvec3 out = rotation;
-		if(parent) out += parent->rotation; //this is probably wrongs
-		return out;
-	};
+	// drawing transform, composed once per frame by Game::UpdateTransforms in the registry
+	glm::dvec3 DrawPosition(){ return transforms? transform()->drawPosition : worldPosition(); }
+	glm::mat4 WorldMatrix(){ return transforms? transform()->worldMatrix : glm::mat4(1.0f); }
 
 	void attach(GameObj* go, glm::vec3 offset = glm::vec3(0.0f));
 //	glm::dvec3 worldScale();//should this be relative :?
@@ -0,0 +1,129 @@
+#include "gravity.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define GRAVITY_X86
+	#include <immintrin.h>
+#endif
+
+SimdLevel DetectSimd(){
+#ifdef GRAVITY_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+	if(__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+	return SIMD_SCALAR;
+}
+
+const char * SimdName(SimdLevel l){
+	switch(l){
+		case SIMD_AVX2: return "avx2";
+		case SIMD_SSE2: return "sse2";
+		default: return "scalar";
+	}
+}
+
+static void GravityScalar(int begin, int end, int n,
+	const double * x, const double * y, const double * m, double G,
+	double * ax, double * ay)
+{
+	for(int i=begin;i<end;i++){
+		double sx=0, sy=0;
+		for(int j=0;j<n;j++){
+			double dx = x[j]-x[i], dy = y[j]-y[i];
+			double d2 = dx*dx+dy*dy;
+			if(d2>0){
+				double f = m[j]/d2;
+				sx += dx*f;
+				sy += dy*f;
+			}
+		}
+		ax[i] = sx*4.*G;
+		ay[i] = sy*4.*G;
+	}
+}
+
+#ifdef GRAVITY_X86
+__attribute__((target("sse2")))
+static void GravitySSE2(int begin, int end, int n,
+	const double * x, const double * y, const double * m, double G,
+	double * ax, double * ay)
+{
+	const __m128d zero = _mm_setzero_pd();
+	int blocks = n & ~1;
+	for(int i=begin;i<end;i++){
+		__m128d xi = _mm_set1_pd(x[i]), yi = _mm_set1_pd(y[i]);
+		__m128d sx = zero, sy = zero;
+		for(int j=0;j<blocks;j+=2){
+			__m128d dx = _mm_sub_pd(_mm_loadu_pd(x+j),xi);
+			__m128d dy = _mm_sub_pd(_mm_loadu_pd(y+j),yi);
+			__m128d d2 = _mm_add_pd(_mm_mul_pd(dx,dx),_mm_mul_pd(dy,dy));
+			//lanes at distance 0 (itself) give inf or nan, masked out
+			__m128d f = _mm_and_pd(_mm_div_pd(_mm_loadu_pd(m+j),d2),_mm_cmpgt_pd(d2,zero));
+			sx = _mm_add_pd(sx,_mm_mul_pd(dx,f));
+			sy = _mm_add_pd(sy,_mm_mul_pd(dy,f));
+		}
+		double lx[2], ly[2];
+		_mm_storeu_pd(lx,sx);
+		_mm_storeu_pd(ly,sy);
+		double tx = lx[0]+lx[1], ty = ly[0]+ly[1];
+		for(int j=blocks;j<n;j++){
+			double dx = x[j]-x[i], dy = y[j]-y[i];
+			double d2 = dx*dx+dy*dy;
+			if(d2>0){
+				tx += dx*m[j]/d2;
+				ty += dy*m[j]/d2;
+			}
+		}
+		ax[i] = tx*4.*G;
+		ay[i] = ty*4.*G;
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void GravityAVX2(int begin, int end, int n,
+	const double * x, const double * y, const double * m, double G,
+	double * ax, double * ay)
+{
+	const __m256d zero = _mm256_setzero_pd();
+	int blocks = n & ~3;
+	for(int i=begin;i<end;i++){
+		__m256d xi = _mm256_set1_pd(x[i]), yi = _mm256_set1_pd(y[i]);
+		__m256d sx = zero, sy = zero;
+		for(int j=0;j<blocks;j+=4){
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x+j),xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y+j),yi);
+			__m256d d2 = _mm256_fmadd_pd(dx,dx,_mm256_mul_pd(dy,dy));
+			__m256d f = _mm256_and_pd(_mm256_div_pd(_mm256_loadu_pd(m+j),d2),_mm256_cmp_pd(d2,zero,_CMP_GT_OQ));
+			sx = _mm256_fmadd_pd(dx,f,sx);
+			sy = _mm256_fmadd_pd(dy,f,sy);
+		}
+		double lx[4], ly[4];
+		_mm256_storeu_pd(lx,sx);
+		_mm256_storeu_pd(ly,sy);
+		double tx = (lx[0]+lx[1])+(lx[2]+lx[3]), ty = (ly[0]+ly[1])+(ly[2]+ly[3]);
+		for(int j=blocks;j<n;j++){
+			double dx = x[j]-x[i], dy = y[j]-y[i];
+			double d2 = dx*dx+dy*dy;
+			if(d2>0){
+				tx += dx*m[j]/d2;
+				ty += dy*m[j]/d2;
+			}
+		}
+		ax[i] = tx*4.*G;
+		ay[i] = ty*4.*G;
+	}
+}
+#endif
+
+void GravityKernel(SimdLevel level, int begin, int end, int n,
+	const double * x, const double * y, const double * m, double G,
+	double * ax, double * ay)
+{
+	static const SimdLevel best = DetectSimd();
+	if(level>best) level = best; //never run what the cpu can't
+#ifdef GRAVITY_X86
+	if(level==SIMD_AVX2) return GravityAVX2(begin,end,n,x,y,m,G,ax,ay);
+	if(level==SIMD_SSE2) return GravitySSE2(begin,end,n,x,y,m,G,ax,ay);
+#endif
+	GravityScalar(begin,end,n,x,y,m,G,ax,ay);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+Pairwise gravity kernel
+computes the attraction of every body on bodies [begin,end) over packed arrays,
+same law as PhyxENG::Gravity2D, coincident bodies don't attract each other
+the widest instruction set the cpu supports is picked at runtime
+**/
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2
+};
+
+SimdLevel DetectSimd();
+const char * SimdName(SimdLevel);
+
+// writes (not accumulates) the acceleration of bodies [begin,end) into ax, ay
+void GravityKernel(SimdLevel, int begin, int end, int n,
+	const double * x, const double * y, const double * m, double G,
+	double * ax, double * ay);
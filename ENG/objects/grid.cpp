@@ -0,0 +1,57 @@
+#include "grid.h"
+#include <algorithm>
+#include <cmath>
+
+void SpatialHash::Clear(double cellSize){
+	cell = (cellSize>0)? cellSize : 1.;
+	entries.clear();
+	for(auto& b : boxes) b.in=false;
+}
+
+glm::ivec2 SpatialHash::Cell(glm::dvec2 p) const {
+	return glm::ivec2((int)std::floor(p.x/cell),(int)std::floor(p.y/cell));
+}
+
+uint64_t SpatialHash::Key(glm::ivec2 c){
+	return ((uint64_t)(uint32_t)c.x<<32) | (uint32_t)c.y;
+}
+
+void SpatialHash::Insert(int id, glm::dvec2 lo, glm::dvec2 hi){
+	if(id>=(int)boxes.size()) boxes.resize(id+1);
+	Box& b = boxes[id];
+	b.lo = lo;
+	b.hi = hi;
+	b.clo = Cell(lo);
+	b.chi = Cell(hi);
+	b.in = true;
+	for(int x=b.clo.x;x<=b.chi.x;x++)
+		for(int y=b.clo.y;y<=b.chi.y;y++){
+			Entry e;
+			e.c = glm::ivec2(x,y);
+			e.key = Key(e.c);
+			e.id = id;
+			entries.push_back(e);
+		}
+}
+
+void SpatialHash::Pairs(std::vector<std::pair<int,int>>& out){
+	out.clear();
+	std::sort(entries.begin(),entries.end(),[](const Entry& a,const Entry& b){
+		return (a.key<b.key) || (a.key==b.key && a.id<b.id);
+	});
+	for(size_t s=0;s<entries.size();){
+		size_t e=s+1;
+		while(e<entries.size() && entries[e].key==entries[s].key) e++;
+		glm::ivec2 c = entries[s].c;
+		for(size_t i=s;i<e;i++)
+			for(size_t j=i+1;j<e;j++){
+				const Box& a = boxes[entries[i].id];
+				const Box& b = boxes[entries[j].id];
+				//a couple sharing several cells is only reported by the first one
+				if(glm::max(a.clo.x,b.clo.x)!=c.x || glm::max(a.clo.y,b.clo.y)!=c.y) continue;
+				if(a.hi.x<b.lo.x || b.hi.x<a.lo.x || a.hi.y<b.lo.y || b.hi.y<a.lo.y) continue;
+				out.push_back(std::make_pair(entries[i].id,entries[j].id));
+			}
+		s=e;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "ENG/includes/glm/glm.hpp"
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+Uniform grid broad phase
+objects are registered with their 2D box every frame,
+only objects whose boxes share a cell and overlap are paired
+**/
+class SpatialHash {
+public:
+	double cell = 1.; //cell width
+
+	void Clear(double cellSize);
+	void Insert(int id, glm::dvec2 lo, glm::dvec2 hi); //ids are indices, keep them dense
+	void Pairs(std::vector<std::pair<int,int>>& out); //every overlapping couple once, lower id first
+
+//private:
+	struct Entry {
+		uint64_t key;
+		int id;
+		glm::ivec2 c; //cell coordinates
+	};
+	struct Box {
+		glm::dvec2 lo,hi;
+		glm::ivec2 clo,chi; //covered cells
+		bool in=false;
+	};
+	std::vector<Entry> entries;
+	std::vector<Box> boxes;
+
+	glm::ivec2 Cell(glm::dvec2 p) const;
+	static uint64_t Key(glm::ivec2 c);
+};
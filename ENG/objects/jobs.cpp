@@ -0,0 +1,94 @@
+#include "jobs.h"
+
+JobSystem::JobSystem(int workers): quit(false), queued(0)
+{
+	if(workers<0) workers = (int)std::thread::hardware_concurrency()-1;
+	if(workers<0) workers = 0;
+	for(int i=0;i<=workers;i++) queues.emplace_back(new Queue());
+	for(int i=0;i<workers;i++) threads.emplace_back(&JobSystem::WorkerLoop,this,i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lk(wakeM);
+		quit = true;
+	}
+	wake.notify_all();
+	for(auto& t : threads) t.join();
+}
+
+void JobSystem::ParallelFor(int count, int grain, const std::function<void(int,int)>& fn)
+{
+	if(count<=0) return;
+	if(grain<1) grain = 1;
+	int chunks = Chunks(count,grain);
+	if(threads.empty() || chunks==1){
+		for(int c=0;c<chunks;c++) fn(c*grain,std::min(count,(c+1)*grain));
+		return;
+	}
+
+	std::atomic<int> pending(chunks);
+	queued += chunks;
+	for(int c=0;c<chunks;c++){
+		Job j = {&fn, c*grain, std::min(count,(c+1)*grain), &pending};
+		Queue& q = *queues[c%queues.size()];
+		std::lock_guard<std::mutex> lk(q.m);
+		q.jobs.push_back(j);
+	}
+	{
+		std::lock_guard<std::mutex> lk(wakeM); //a worker checking queued is now either awake or waiting
+	}
+	wake.notify_all();
+
+	int self = queues.size()-1;
+	Job j;
+	while(pending.load()>0){
+		if(Pop(self,j) || Steal(self,j)) Run(j);
+		else std::this_thread::yield(); //the last chunks are running elsewhere
+	}
+}
+
+bool JobSystem::Pop(int q, Job& out)
+{
+	Queue& queue = *queues[q];
+	std::lock_guard<std::mutex> lk(queue.m);
+	if(queue.jobs.empty()) return false;
+	out = queue.jobs.back();
+	queue.jobs.pop_back();
+	queued--;
+	return true;
+}
+
+bool JobSystem::Steal(int q, Job& out)
+{
+	for(int k=1;k<queues.size();k++){
+		Queue& victim = *queues[(q+k)%queues.size()];
+		std::lock_guard<std::mutex> lk(victim.m);
+		if(victim.jobs.empty()) continue;
+		out = victim.jobs.front();
+		victim.jobs.pop_front();
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::Run(Job& j)
+{
+	(*j.fn)(j.begin,j.end);
+	j.pending->fetch_sub(1);
+}
+
+void JobSystem::WorkerLoop(int q)
+{
+	while(!quit){
+		Job j;
+		if(Pop(q,j) || Steal(q,j)){
+			Run(j);
+			continue;
+		}
+		std::unique_lock<std::mutex> lk(wakeM);
+		wake.wait(lk,[this]{return quit || queued.load()>0;});
+	}
+}
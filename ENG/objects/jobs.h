@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+/**
+Job system
+a pool of workers each owning a queue of jobs, idle workers steal from the others
+ParallelFor cuts a range in fixed chunks, whoever runs them, so as long as every
+chunk writes its own outputs and the caller reduces them in chunk order
+the results don't depend on the number of threads
+**/
+class JobSystem {
+public:
+	JobSystem(int workers = -1); //-1: one less than the hardware threads, 0: run everything inline
+	~JobSystem();
+
+	//calls fn(begin,end) over [0,count) in chunks of grain and waits for all of them
+	//the calling thread works too, call it from one thread at a time
+	void ParallelFor(int count, int grain, const std::function<void(int,int)>& fn);
+	int Chunks(int count, int grain) const {return (grain<1)? count : (count+grain-1)/grain;}
+	int Workers() const {return threads.size();}
+
+//private:
+	struct Job {
+		const std::function<void(int,int)> * fn;
+		int begin, end;
+		std::atomic<int> * pending;
+	};
+	struct Queue {
+		std::mutex m;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<Queue>> queues; //one per worker, the last one is the caller's
+	std::atomic<bool> quit;
+	std::atomic<int> queued;
+	std::mutex wakeM;
+	std::condition_variable wake;
+
+	bool Pop(int q, Job&); //own queue, newest first
+	bool Steal(int q, Job&); //other queues, oldest first
+	void Run(Job&);
+	void WorkerLoop(int q);
+};
@@ -1,135 +1,857 @@
 #include "kldr.h"
+#include "pool.h"
+#include <cmath>
+#include <limits>
 //static const int LAYERS = 1;
 
 Collider::Collider(GameObj* p,int l){
 	parent=p;
+	p->children.push_back(this); //follows its object's moves
 	layer=l;
 	scale = glm::vec3(1);
 }
 
-std::vector<Collider *> CollisionObj::collidersLayer(int l){
-	std::vector<Collider *> out;
-	for(auto& c : colliders) if(c->layer==l) out.push_back(c);
-	return out;
+double Collider::Reach(){
+	switch(type){
+	case COLLIDER_CIRCLE: return static_cast<CircleCollider *>(this)->Dim();
+	case COLLIDER_CAPSULE: {
+		CapsuleCollider *k = static_cast<CapsuleCollider *>(this);
+		return glm::max(glm::length(k->ends[0]),glm::length(k->ends[1]))+k->radius;
+	}
+	case COLLIDER_POLYGON: return static_cast<PolygonCollider *>(this)->reach;
+	default: return 0;
+	}
+}
+
+std::vector<glm::dvec2> PolygonCollider::Hull(std::vector<glm::dvec2> p){
+	//monotone chain, collinear points dropped
+	std::sort(p.begin(),p.end(),[](const glm::dvec2& a,const glm::dvec2& b){ return a.x<b.x || (a.x==b.x && a.y<b.y); });
+	p.erase(std::unique(p.begin(),p.end()),p.end());
+	if(p.size()<3) return p;
+	auto cross = [](glm::dvec2 o,glm::dvec2 a,glm::dvec2 b){ return (a.x-o.x)*(b.y-o.y)-(a.y-o.y)*(b.x-o.x); };
+	std::vector<glm::dvec2> h(2*p.size());
+	int k = 0;
+	for(int i=0;i<p.size();i++){ //lower
+		while(k>=2 && cross(h[k-2],h[k-1],p[i])<=0) k--;
+		h[k++] = p[i];
+	}
+	for(int i=p.size()-2,t=k+1;i>=0;i--){ //upper
+		while(k>=t && cross(h[k-2],h[k-1],p[i])<=0) k--;
+		h[k++] = p[i];
+	}
+	h.resize(k-1);
+	return h;
+}
+
+const std::vector<Collider *>& CollisionObj::collidersLayer(int l){
+	static const std::vector<Collider *> none;
+	return (l>=0 && l<layers.size())? layers[l] : none;
+}
+
+//capsules and polygons turn about their object, their xz offset goes into the points to turn with them
+static void FoldOffset(Collider * c){
+	glm::dvec2 off(c->position.x,c->position.z);
+	if(off==glm::dvec2(0)) return;
+	if(c->type==COLLIDER_CAPSULE){
+		CapsuleCollider *k = static_cast<CapsuleCollider *>(c);
+		k->ends[0] += off;
+		k->ends[1] += off;
+	} else if(c->type==COLLIDER_POLYGON){
+		PolygonCollider *k = static_cast<PolygonCollider *>(c);
+		k->reach = 0;
+		for(auto& p : k->points){ p += off; k->reach = glm::max(k->reach,glm::length(p)); }
+	} else return;
+	c->Position(glm::dvec3(0,c->position.y,0));
+}
+
+void CollisionObj::IndexColliders(){
+	for(auto& l : layers) l.clear(); //lists keep their capacity
+	mask = 0;
+	hasBound = false;
+	glm::dvec2 lo, hi;
+	for(auto c : colliders){
+		FoldOffset(c); //the bound below then holds them at any yaw
+		if(c->layer<0 || c->layer>=MAX_LAYERS) continue;
+		if(c->layer>=layers.size()) layers.resize(c->layer+1);
+		layers[c->layer].push_back(c);
+		mask |= 1u<<c->layer;
+		if(c->type==COLLIDER_NONE) continue; //never collides
+		glm::dvec2 p(c->position.x,c->position.z);
+		glm::dvec2 r(c->Reach());
+		if(!hasBound){ lo = p-r; hi = p+r; hasBound = true; }
+		else { lo = glm::min(lo,p-r); hi = glm::max(hi,p+r); }
+	}
+	if(!hasBound) return;
+	boundCenter = (lo+hi)*.5;
+	boundRadius = 0;
+	for(auto c : colliders)
+		if(c->type!=COLLIDER_NONE)
+			boundRadius = glm::max(boundRadius,glm::length(glm::dvec2(c->position.x,c->position.z)-boundCenter)+c->Reach());
 }
 void CollisionObj::CreateCollider(glm::dvec3 pos,int l){
-	Collider *in = new CircleCollider(this,l);
-	in->position = pos;
+	Collider *in = arena? arena->New<CircleCollider>(this,l) : new CircleCollider(this,l);
+	in->Position(pos);
 	colliders.push_back(in);
+	IndexColliders();
 }
 
 void CollisionObj::CreateCollider(glm::dvec3 pos,int l, float size){
-	Collider *in = new CircleCollider(this,l, size);
-	in->position = pos;
+	Collider *in = arena? arena->New<CircleCollider>(this,l, size) : new CircleCollider(this,l, size);
+	in->Position(pos);
+	colliders.push_back(in);
+	IndexColliders();
+}
+
+void CollisionObj::CreateCapsuleCollider(glm::dvec3 pos,int l, glm::dvec2 e0, glm::dvec2 e1, double radius){
+	Collider *in = arena? arena->New<CapsuleCollider>(this,l,e0,e1,radius) : new CapsuleCollider(this,l,e0,e1,radius);
+	in->Position(pos);
+	colliders.push_back(in);
+	IndexColliders();
+}
+
+void CollisionObj::CreatePolygonCollider(glm::dvec3 pos,int l, const std::vector<glm::dvec2>& points){
+	Collider *in = arena? arena->New<PolygonCollider>(this,l,points) : new PolygonCollider(this,l,points);
+	in->Position(pos);
 	colliders.push_back(in);
+	IndexColliders();
+}
+
+template <typename T> static void FreeCollider(Arena* arena, Collider* c){
+	T* shape = static_cast<T*>(c); //pools are by exact type
+	if(arena) arena->Delete(shape);
+	else delete shape;
+}
+
+void CollisionObj::ReleaseColliders(){
+	for(auto c : colliders){
+		children.erase(std::remove(children.begin(),children.end(),(GameObj*)c),children.end());
+		switch(c->type){
+		case COLLIDER_CAPSULE: FreeCollider<CapsuleCollider>(arena,c); break;
+		case COLLIDER_POLYGON: FreeCollider<PolygonCollider>(arena,c); break;
+		default: FreeCollider<CircleCollider>(arena,c);
+		}
+	}
+	colliders.clear();
+	IndexColliders();
 }
 
 void CollisionObj::UpdateCollider(glm::dvec3 pos, int l, float size, int n)
 {
-	colliders[n]->position = pos;
+	colliders[n]->Position(pos);
 	colliders[n]->layer = l;
-	colliders[n]->scale = glm::vec3(size);
+	colliders[n]->Scale(glm::dvec3(size));
+	IndexColliders();
+}
+
+CollisionENG::CollisionENG(){
+	for(int l=0;l<MAX_LAYERS;l++) matrix[l] = 1u<<l;
+}
+
+void CollisionENG::Interact(int a,int b,bool on){
+	if(a<0 || b<0 || a>=MAX_LAYERS || b>=MAX_LAYERS) return;
+	if(on){ matrix[a] |= 1u<<b; matrix[b] |= 1u<<a; }
+	else { matrix[a] &= ~(1u<<b); matrix[b] &= ~(1u<<a); }
+}
+
+void CollisionENG::Trigger(int l,bool on){
+	if(l<0 || l>=MAX_LAYERS) return;
+	if(on) triggers |= 1u<<l;
+	else triggers &= ~(1u<<l);
+}
+
+LayerMask CollisionENG::Reach(LayerMask m) const {
+	LayerMask out = 0;
+	for(int l=0;l<MAX_LAYERS && (m>>l);l++)
+		if((m>>l)&1) out |= matrix[l];
+	return out;
 }
 
 void CollisionENG::Init(std::vector<GameObj*>* gameobjects){
 	managed.clear();
+	treeCurrent = false;
 	for (unsigned int i = 0; i < gameobjects->size(); i++)
 	{
 		GameObj* go = gameobjects->at(i);
 		CollisionObj* cast = dynamic_cast<CollisionObj *>(go);
-		if(cast) managed.push_back(cast);
+		if(cast){
+			cast->collId = managed.size();
+			managed.push_back(cast);
+		}
 	}
 }
 
+void CollisionENG::Init(Registry& registry){
+	managed.clear();
+	treeCurrent = false;
+	registry.Query<Collidable>().Each([this](Entity, Collidable& c){
+		c.obj->collId = managed.size();
+		managed.push_back(c.obj);
+	});
+}
+
+void CollisionENG::Add(CollisionObj* o){
+	if(o->collId>=0) return;
+	o->collId = managed.size();
+	managed.push_back(o);
+	treeCurrent = false; //queries before the next Update find it
+}
+
+CollisionObj * CollisionENG::Remove(CollisionObj* o){
+	int id = o->collId;
+	if(id<0 || id>=managed.size() || managed[id]!=o) return nullptr;
+	DropEvents();
+	CollisionObj * last = managed.back();
+	managed[id] = last;
+	last->collId = id;
+	managed.pop_back();
+	o->collId = -1;
+	treeCurrent = false; //the tree still has the last collId, and the moved object at its old id
+	return (last==o)? nullptr : last;
+}
+
 void CollisionENG::Update(){
 //	TESTLOG("CollisionENG::Update");
+	treeCurrent = false;
 	CheckCollisions();//Generate Events //in update
 	CleanEvents();
+	IndexEvents();
 }
 
 void CollisionENG::CheckCollisions(){
 //	TESTLOG("CollisionENG::CheckCollisions");
-	for(int i=0;i<managed.size();i++){
-			CollisionObj * p = managed[i];
-		for(int j=i+1;j<managed.size();j++){ //this kind of loop allows us to only check a couple once
-			for(int l=0;l<LAYERS;l++){
+	long n = managed.size();
+	pairsTotal = n*(n-1)/2;
+	if(broadphase == BruteForce){
+		for(int i=0;i<managed.size();i++){
+				CollisionObj * p = managed[i];
+			for(int j=i+1;j<managed.size();j++){ //this kind of loop allows us to only check a couple once
 				CollisionObj * q = managed[j];
-				CollisionMsg * coll = Collision(p,q,l);
-				if(coll) events.push_back(coll);
+				if(p->sleeping && q->sleeping) continue;
+				if(!Interacts(p,q) || !BoundsOverlap(p,q)) continue;
+				Collide(p,q,events);
 			}
 		}
+		pairsTested = pairsTotal;
+	} else {
+		BroadPhasePairs();
+		NarrowPhase();
+		pairsTested = candidates.size();
+	}
+	pairsCulled = pairsTotal - pairsTested;
+}
+
+void CollisionENG::BroadPhasePairs(){
+	boundsLo.resize(managed.size());
+	boundsHi.resize(managed.size());
+	hasBounds.assign(managed.size(),false);
+	//world positions are cached on first use, fill the caches before threads read them
+	if(jobs) for(auto o : managed){
+		o->worldPosition();
+		for(auto c : o->colliders) c->worldPosition();
+	}
+	auto bounds = [this](int b,int e){
+		for(int i=b;i<e;i++) hasBounds[i] = Bounds(managed[i],boundsLo[i],boundsHi[i]);
+	};
+	if(jobs) jobs->ParallelFor(managed.size(),512,bounds);
+	else bounds(0,managed.size());
+	if(broadphase == Tree){
+		//only objects that left their fat box move in the tree
+		for(int i=0;i<managed.size();i++)
+			if(hasBounds[i]) tree.Update(i,boundsLo[i],boundsHi[i]);
+			else tree.Remove(i);
+		tree.Truncate(managed.size()); //collIds given back by Remove
+		tree.Pairs(candidates);
+		treeCurrent = true;
+		FilterCandidates();
+		return;
+	}
+	//cells as wide as the biggest box, so nothing covers more than 2x2 cells
+	double biggest = 0;
+	for(int i=0;i<managed.size();i++)
+		if(hasBounds[i]) biggest = glm::max(biggest,glm::max(boundsHi[i].x-boundsLo[i].x,boundsHi[i].y-boundsLo[i].y));
+	grid.Clear(biggest);
+	for(int i=0;i<managed.size();i++)
+		if(hasBounds[i]) grid.Insert(i,boundsLo[i],boundsHi[i]);
+	grid.Pairs(candidates);
+	FilterCandidates();
+}
+
+void CollisionENG::FilterCandidates(){
+	//couples the layer matrix keeps apart, or both asleep, never reach the narrow phase or its threads
+	int n = 0;
+	for(auto& c : candidates){
+		CollisionObj *p = managed[c.first], *q = managed[c.second];
+		if(p->sleeping && q->sleeping) continue;
+		if(Interacts(p,q)) candidates[n++] = c;
+	}
+	candidates.resize(n);
+}
+
+void CollisionENG::NarrowPhase(){
+	if(!jobs){
+		for(auto& c : candidates){
+			CollisionObj *p = managed[c.first], *q = managed[c.second];
+			if(!BoundsOverlap(p,q)) continue;
+			Collide(p,q,events);
+		}
+		return;
+	}
+	//each chunk fills its own buffer, appended in chunk order so events come out as in a serial run
+	const int grain = 256;
+	int chunks = jobs->Chunks(candidates.size(),grain);
+	if(chunkEvents.size()<chunks) chunkEvents.resize(chunks);
+	jobs->ParallelFor(candidates.size(),grain,[this,grain](int b,int e){
+		std::vector<CollisionMsg>& out = chunkEvents[b/grain];
+		out.clear();
+		for(int k=b;k<e;k++){
+			CollisionObj *p = managed[candidates[k].first], *q = managed[candidates[k].second];
+			if(!BoundsOverlap(p,q)) continue;
+			Collide(p,q,out);
+		}
+	});
+	for(int c=0;c<chunks;c++) events.insert(events.end(),chunkEvents[c].begin(),chunkEvents[c].end());
+}
+
+void CollisionENG::SyncTree(){
+	//only objects that left their fat box move, its couples are refreshed by the next Pairs in Tree mode
+	if(treeCurrent) return;
+	glm::dvec2 lo, hi;
+	for(int i=0;i<managed.size();i++)
+		if(Bounds(managed[i],lo,hi)) tree.Update(i,lo,hi);
+		else tree.Remove(i);
+	tree.Truncate(managed.size());
+	treeCurrent = true;
+}
+
+bool CollisionENG::Bounds(CollisionObj* o, glm::dvec2& lo, glm::dvec2& hi){
+	if(!o->hasBound) return false;
+	glm::dvec2 c = o->BoundCenter();
+	glm::dvec2 r(o->boundRadius);
+	lo = c-r;
+	hi = c+r;
+	return true;
+}
+
+bool CollisionENG::BoundsOverlap(CollisionObj* p, CollisionObj* q){
+	if(!p->hasBound || !q->hasBound) return false;
+	glm::dvec2 d = q->BoundCenter()-p->BoundCenter();
+	double r = p->boundRadius+q->boundRadius;
+	return glm::dot(d,d) <= r*r;
+}
+
+bool CollisionENG::Interacts(CollisionObj* p, CollisionObj* q) const {
+	return (Reach(p->mask) & q->mask)!=0;
+}
+
+void CollisionENG::Collide(CollisionObj* p, CollisionObj* q, std::vector<CollisionMsg>& out){
+	//only the layer couples the matrix allows, no layer is looked at blindly
+	CollisionMsg coll;
+	for(int a=0;a<MAX_LAYERS && (p->mask>>a);a++){
+		if(!((p->mask>>a)&1)) continue;
+		LayerMask meets = matrix[a] & q->mask;
+		for(int b=0;b<MAX_LAYERS && (meets>>b);b++)
+			if(((meets>>b)&1) && Collision(p,q,a,b,coll)) out.push_back(coll);
+	}
+}
+
+void CollisionENG::Sweep(const std::vector<glm::dvec2>& motion, double fast, std::vector<CollisionMsg>& out){
+	out.clear();
+	auto moved = [&](int i){ return (i<motion.size())? motion[i] : glm::dvec2(0); };
+	auto isFast = [&](int i){
+		glm::dvec2 m = moved(i);
+		double r = managed[i]->boundRadius*fast;
+		return managed[i]->hasBound && glm::dot(m,m) > r*r;
+	};
+	//slow ones can't skip over anything, the discrete test sees them
+	//fast ones are few, the others are found along their path in the tree
+	sweepFast.clear();
+	double slowMotion = 0; //longest step of a slow one
+	for(int i=0;i<managed.size();i++){
+		if(!managed[i]->hasBound) continue;
+		if(isFast(i)) sweepFast.push_back(i);
+		else slowMotion = glm::max(slowMotion,glm::length(moved(i)));
+	}
+	if(sweepFast.empty()) return;
+	treeCurrent = false;
+	SyncTree(); //boxes where the step ended
+	CollisionMsg coll;
+	auto test = [&](int i, int j){
+		CollisionObj *p = managed[i], *q = managed[j];
+		if(!Interacts(p,q)) return;
+		glm::dvec2 mp = moved(i), mq = moved(j);
+		//bounding circles first, the colliders only if they met
+		glm::dvec2 s = (p->BoundCenter()-mp) - (q->BoundCenter()-mq);
+		double t;
+		if(!SweptCircle(s,mp-mq,p->boundRadius+q->boundRadius,t)) return;
+		if(SweepColliders(p,q,mp,mq,coll)) out.push_back(coll);
+	};
+	for(int k=0;k<sweepFast.size();k++){
+		int i = sweepFast[k];
+		CollisionObj * p = managed[i];
+		glm::dvec2 end = p->BoundCenter(), start = end-moved(i);
+		//grown by the slow ones' own step, their boxes are where they ended
+		glm::dvec2 r(p->boundRadius+slowMotion);
+		tree.Query(glm::min(start,end)-r,glm::max(start,end)+r,[&](int j){
+			if(j!=i && !isFast(j)) test(i,j);
+			return true;
+		});
+		for(int l=k+1;l<sweepFast.size();l++) test(i,sweepFast[l]); //couples of fast ones once
+	}
+	std::sort(out.begin(),out.end(),[](const CollisionMsg& a,const CollisionMsg& b){ return a.contact.toi<b.contact.toi; });
+}
+
+bool CollisionENG::SweepColliders(CollisionObj* p, CollisionObj* q, glm::dvec2 mp, glm::dvec2 mq, CollisionMsg& out){
+	bool found = false;
+	glm::dvec2 d = mp-mq;
+	for(int a=0;a<MAX_LAYERS && (p->mask>>a);a++){
+		if(!((p->mask>>a)&1)) continue;
+		LayerMask meets = matrix[a] & q->mask;
+		for(int b=0;b<MAX_LAYERS && (meets>>b);b++){
+			if(!((meets>>b)&1)) continue;
+			for(auto pc : p->collidersLayer(a))
+				for(auto qc : q->collidersLayer(b)){
+					if(pc->type!=COLLIDER_CIRCLE || qc->type!=COLLIDER_CIRCLE) continue; //only circles are swept
+					double r = static_cast<CircleCollider *>(pc)->Dim()+static_cast<CircleCollider *>(qc)->Dim();
+					glm::dvec2 s = (pc->worldPosition2D()-mp) - (qc->worldPosition2D()-mq);
+					double t;
+					if(!SweptCircle(s,d,r,t) || (found && t>=out.contact.toi)) continue;
+					found = true;
+					glm::dvec2 q2p = s+d*t;
+					double l = glm::length(q2p);
+					out.P = std::make_pair(p,pc);
+					out.Q = std::make_pair(q,qc);
+					out.layer = a;
+					out.qlayer = b;
+					out.trigger = ((triggers>>a)&1) || ((triggers>>b)&1);
+					out.life = 1;
+					out.pid = p->collId;
+					out.qid = q->collId;
+					out.contact.normal = (l>0.)? q2p/l : glm::dvec2(1,0);
+					out.contact.distance = r;
+					out.contact.penetration = 0;
+					out.contact.toi = t;
+				}
+		}
 	}
+	return found;
+}
+
+bool CollisionENG::SweptCircle(glm::dvec2 s, glm::dvec2 d, double r, double& t){
+	double c = glm::dot(s,s)-r*r;
+	if(c<=0.) return false; //touching from the start, not a sweep
+	double a = glm::dot(d,d);
+	double b = glm::dot(s,d);
+	if(a<=0. || b>=0.) return false; //not getting closer
+	double disc = b*b-a*c;
+	if(disc<0.) return false; //passing by
+	t = (-b-std::sqrt(disc))/a;
+	return t<=1.;
 }
 
 void CollisionENG::CleanEvents(){
 //	TESTLOG("CollisionENG::CleanEvents");
+	//compact in place, the buffer keeps its capacity from one frame to the next
+	int kept = 0;
 	for(auto& e : events)
-		if(e->life<=0){
-			delete e;
-			e=nullptr;
-		} else e->life--;
-					
-	events.erase(
-		std::remove(events.begin(), events.end(), nullptr),
-		events.end()
-		);
-}
-
-CollisionMsg * CollisionENG::Collision(CollisionObj* p,CollisionObj* q,int l){
-//	TESTLOG("11 Collision" TAB p->name TAB q->name TAB l);
-	std::vector<Collider *> pcs = p->collidersLayer(l);
-	std::vector<Collider *> qcs = q->collidersLayer(l);
+		if(e.life>0){
+			e.life--;
+			events[kept++] = e;
+		}
+	events.resize(kept);
+}
+
+bool CollisionENG::Collision(CollisionObj* p,CollisionObj* q,int l,int ql, CollisionMsg& out){
+//	TESTLOG("11 Collision" TAB p->name TAB q->name TAB l TAB ql);
+	const std::vector<Collider *>& pcs = p->collidersLayer(l);
+	const std::vector<Collider *>& qcs = q->collidersLayer(ql);
 //	TESTLOG("P collider num:" TAB pcs.size());
 	int tests = 0;
 	for(auto& pc : pcs) 
 		for(auto& qc : qcs){
 			tests++;
-			if(ColliderCollision(pc,qc)){
+			if(ColliderCollision(pc,qc,out.contact)){
 				TESTLOG("CollisionENG::Collision " TAB p->name TAB q->name TAB l);
-				return new CollisionMsg(std::make_pair(p,pc),std::make_pair(q,qc),l);
+				out.P = std::make_pair(p,pc);
+				out.Q = std::make_pair(q,qc);
+				out.layer = l;
+				out.qlayer = ql;
+				out.trigger = ((triggers>>l)&1) || ((triggers>>ql)&1);
+				out.life = 1;
+				out.pid = p->collId;
+				out.qid = q->collId;
+				return true;
 			}
 		} 
 //	TESTLOG("Collision Tests:" TAB tests);
-	return nullptr;
+	return false;
 }
 
-CollisionMsg * CollisionENG::CollisionBetween(GameObj* p,GameObj* q,int l){
-	for(auto& e : events)
-		if((e->P.first==p)&&(e->Q.first==q)&&(e->layer==l))
-			return e;
-	return nullptr;
+void CollisionENG::IndexEvents(){
+	LayerMask used = 0;
+	for(auto o : managed) used |= o->mask;
+	LAYERS = 1;
+	while(LAYERS<MAX_LAYERS && (used>>LAYERS)) LAYERS++;
+	adjacency.resize(managed.size()*LAYERS);
+	for(auto& a : adjacency) a.clear(); //lists keep their capacity
+	for(int i=0;i<events.size();i++){
+		CollisionMsg& e = events[i];
+		if(e.pid<0 || e.qid<0 || e.pid>=managed.size() || e.qid>=managed.size()) continue;
+		if(e.layer>=LAYERS || e.qlayer>=LAYERS) continue; //collider moved to another layer since
+		adjacency[e.pid*LAYERS+e.layer].push_back(i);
+		adjacency[e.qid*LAYERS+e.qlayer].push_back(i);
+	}
 }
 
-CollisionMsg * CollisionENG::CollisionWith(GameObj* p,int l){
-	for(auto& e : events)
-		if((e->P.first==p)||(e->Q.first==p)&&(e->layer==l))
-			return e;
+void CollisionENG::DropEvents(){
+	//events only live until the next Update, only the lists they filled need clearing
+	for(auto& e : events){
+		if(e.pid>=0 && e.pid*LAYERS+e.layer<adjacency.size()) adjacency[e.pid*LAYERS+e.layer].clear();
+		if(e.qid>=0 && e.qid*LAYERS+e.qlayer<adjacency.size()) adjacency[e.qid*LAYERS+e.qlayer].clear();
+	}
+	events.clear();
+}
+
+const std::vector<int>& CollisionENG::Adjacency(CollisionObj* p,int l){
+	int k = p->collId*LAYERS+l;
+	if(p->collId<0 || l<0 || l>=LAYERS || k>=adjacency.size()) return noEvents;
+	return adjacency[k];
+}
+
+CollisionMsg * CollisionENG::CollisionBetween(CollisionObj* p,CollisionObj* q,int l){
+	for(int i : Adjacency(p,l))
+		if((events[i].pid==p->collId)&&(events[i].qid==q->collId))
+			return &events[i];
 	return nullptr;
 }
 
-std::vector<CollisionMsg *> CollisionENG::CollisionsWith(GameObj* p,int l){
-	std::vector<CollisionMsg *> out;
-	for(auto& e : events)
-		if((e->P.first==p)||(e->Q.first==p)&&(e->layer==l))
-			out.push_back(e);
-	return out;
+CollisionMsg * CollisionENG::CollisionWith(CollisionObj* p,int l){
+	const std::vector<int>& a = Adjacency(p,l);
+	return a.empty()? nullptr : &events[a[0]];
+}
+
+CollisionView CollisionENG::CollisionsWith(CollisionObj* p,int l){
+	return CollisionView(events,Adjacency(p,l));
+}
+
+static bool CircleCircle(Collider * A,Collider * B,Contact& c){
+	return CollisionENG::CircleCollision(static_cast<CircleCollider *>(A),static_cast<CircleCollider *>(B),c);
 }
 
-bool CollisionENG::ColliderCollision(Collider * A,Collider * B){
+#define SAT CollisionENG::ConvexCollision
+const CollisionENG::ShapeTest CollisionENG::shapeTests[COLLIDER_TYPES][COLLIDER_TYPES] = {
+	//					NONE		CIRCLE		CAPSULE		POLYGON
+	/*NONE*/	{	nullptr,	nullptr,	nullptr,	nullptr	},
+	/*CIRCLE*/	{	nullptr,	CircleCircle,	SAT,		SAT	},
+	/*CAPSULE*/	{	nullptr,	SAT,		SAT,		SAT	},
+	/*POLYGON*/	{	nullptr,	SAT,		SAT,		SAT	}
+};
+#undef SAT
+
+bool CollisionENG::ColliderCollision(Collider * A,Collider * B,Contact& c){
 //	TESTLOG("111 Collider Collision");
-	CircleCollider *Ac = dynamic_cast<CircleCollider *>(A);
-	CircleCollider *Bc = dynamic_cast<CircleCollider *>(B);
-	if(Ac&&Bc) {
-		return CircleCollision(Ac,Bc);}
-	return false;
+	ShapeTest test = shapeTests[A->type][B->type];
+	return test && test(A,B,c);
 }
 
-bool CollisionENG::CircleCollision(CircleCollider * A,CircleCollider * B){
-	return (glm::distance(A->worldPosition(),B->worldPosition()) <= (A->Dim()+B->Dim())); 
+bool CollisionENG::CircleCollision(CircleCollider * A,CircleCollider * B,Contact& c){
+	glm::dvec2 q2p = A->worldPosition2D()-B->worldPosition2D();
+	double d2 = glm::dot(q2p,q2p);
+	double r = A->Dim()+B->Dim();
+	if(d2 > r*r) return false;
+	c.distance = std::sqrt(d2);
+	c.normal = (c.distance>0.)? q2p/c.distance : glm::dvec2(1,0); //concentric, any way out
+	c.penetration = r-c.distance;
+	return true;
+}
+
+//a shape as a convex set of points grown by a radius, a circle is one point, a capsule two
+struct Rounded {
+	glm::dvec2 origin; //world position of the collider
+	const glm::dvec2 * pts; //relative to origin, before the yaw
+	int n;
+	double r;
+	glm::dvec2 yaw = glm::dvec2(1,0); //cos, sin, turns the points like the model is drawn
+	glm::dvec2 Turn(glm::dvec2 v) const {return glm::dvec2(yaw.x*v.x+yaw.y*v.y,yaw.x*v.y-yaw.y*v.x);}
+	glm::dvec2 Unturn(glm::dvec2 v) const {return glm::dvec2(yaw.x*v.x-yaw.y*v.y,yaw.x*v.y+yaw.y*v.x);}
+	glm::dvec2 P(int i) const {return origin+Turn(pts[i]);}
+	int Edges() const {return (n<2)? 0 : (n==2)? 1 : n;}
+};
+
+static const glm::dvec2 centerPoint(0);
+
+static glm::dvec2 Yaw(GameObj * o){ //cos, sin, from the orientation composed like Game::UpdateTransforms
+	glm::dmat4 m(1.0);
+	for(;o;o=o->parent){ //parents' rotations before its own
+		glm::dmat4 r = glm::rotate(glm::dmat4(1.0),glm::radians(o->rotation.x),glm::dvec3(1,0,0));
+		r = glm::rotate(r,glm::radians(o->rotation.y),glm::dvec3(0,1,0));
+		r = glm::rotate(r,glm::radians(o->rotation.z),glm::dvec3(0,0,1));
+		m = r*m;
+	}
+	glm::dvec2 x(m[0][0],-m[0][2]); //where the local x axis ends up, seen from above
+	double l = glm::length(x);
+	return (l>1e-9)? x/l : glm::dvec2(1,0); //pitched on its side, seen edge on
+}
+
+static Rounded AsRounded(Collider * c){
+	Rounded s;
+	s.origin = c->worldPosition2D();
+	if(c->type!=COLLIDER_CIRCLE) s.yaw = Yaw(c);
+	if(c->type==COLLIDER_CIRCLE){
+		s.pts = &centerPoint;
+		s.n = 1;
+		s.r = static_cast<CircleCollider *>(c)->Dim();
+	} else if(c->type==COLLIDER_CAPSULE){
+		CapsuleCollider *k = static_cast<CapsuleCollider *>(c);
+		s.pts = k->ends;
+		s.n = 2;
+		s.r = k->radius;
+	} else {
+		PolygonCollider *k = static_cast<PolygonCollider *>(c);
+		s.pts = k->points.data();
+		s.n = k->points.size();
+		s.r = 0;
+	}
+	return s;
+}
+
+static glm::dvec2 ClosestOnSegment(glm::dvec2 p, glm::dvec2 a, glm::dvec2 b){
+	glm::dvec2 ab = b-a;
+	double l2 = glm::dot(ab,ab);
+	double t = (l2>0.)? glm::clamp(glm::dot(p-a,ab)/l2,0.,1.) : 0.;
+	return a+ab*t;
+}
+
+static glm::dvec2 ClosestOnBoundary(glm::dvec2 p, const Rounded& s){
+	if(s.n==1) return s.P(0);
+	glm::dvec2 best = s.P(0);
+	double bd = -1;
+	for(int i=0;i<s.Edges();i++){
+		glm::dvec2 c = ClosestOnSegment(p,s.P(i),s.P((i+1)%s.n));
+		double d = glm::dot(c-p,c-p);
+		if(bd<0 || d<bd){ bd = d; best = c; }
+	}
+	return best;
+}
+
+static void Project(const Rounded& s, glm::dvec2 axis, double& lo, double& hi){
+	lo = hi = glm::dot(s.P(0),axis);
+	for(int i=1;i<s.n;i++){
+		double d = glm::dot(s.P(i),axis);
+		lo = glm::min(lo,d);
+		hi = glm::max(hi,d);
+	}
+	lo -= s.r;
+	hi += s.r;
+}
+
+//false when the axis separates them, keeps the one they overlap least along
+static bool TryAxis(const Rounded& A, const Rounded& B, glm::dvec2 axis, double& best, glm::dvec2& bestAxis){
+	double l = glm::length(axis);
+	if(l<=1e-12) return true;
+	axis /= l;
+	double alo, ahi, blo, bhi;
+	Project(A,axis,alo,ahi);
+	Project(B,axis,blo,bhi);
+	double overlap = glm::min(ahi,bhi)-glm::max(alo,blo);
+	if(overlap<0.) return false;
+	if(overlap<best){ best = overlap; bestAxis = axis; }
+	return true;
+}
+
+static bool EdgeAxes(const Rounded& S, const Rounded& A, const Rounded& B, double& best, glm::dvec2& axis){
+	for(int i=0;i<S.Edges();i++){
+		glm::dvec2 e = S.P((i+1)%S.n)-S.P(i);
+		if(!TryAxis(A,B,glm::dvec2(-e.y,e.x),best,axis)) return false;
+	}
+	return true;
+}
+
+bool CollisionENG::ConvexCollision(Collider * a,Collider * b,Contact& c){
+	Rounded A = AsRounded(a), B = AsRounded(b);
+	if(A.n==0 || B.n==0) return false;
+	double best = std::numeric_limits<double>::max();
+	glm::dvec2 axis(1,0);
+	if(!EdgeAxes(A,A,B,best,axis) || !EdgeAxes(B,A,B,best,axis)) return false;
+	//rounded corners, from each point of one to the nearest of the other
+	if(A.r>0. || B.r>0.){
+		for(int i=0;i<A.n;i++) if(!TryAxis(A,B,A.P(i)-ClosestOnBoundary(A.P(i),B),best,axis)) return false;
+		for(int i=0;i<B.n;i++) if(!TryAxis(A,B,B.P(i)-ClosestOnBoundary(B.P(i),A),best,axis)) return false;
+	}
+	if(best==std::numeric_limits<double>::max()) return false; //two bare points
+	glm::dvec2 ca(0), cb(0);
+	for(int i=0;i<A.n;i++) ca += A.P(i);
+	for(int i=0;i<B.n;i++) cb += B.P(i);
+	ca /= (double)A.n;
+	cb /= (double)B.n;
+	if(glm::dot(axis,ca-cb)<0.) axis = -axis; //from Q towards P
+	c.normal = axis;
+	c.penetration = best;
+	c.distance = glm::length(ca-cb);
+	return true;
+}
+
+static bool InsideCore(glm::dvec2 p, const Rounded& s){ //in the polygon of its points, counter clockwise
+	if(s.n<3) return false;
+	for(int i=0;i<s.n;i++){
+		glm::dvec2 a = s.P(i), e = s.P((i+1)%s.n)-a;
+		if(e.x*(p.y-a.y)-e.y*(p.x-a.x)<0.) return false;
+	}
+	return true;
+}
+
+double CollisionENG::ShapeDistance(Collider * c, glm::dvec2 p){
+	if(c->type==COLLIDER_NONE) return std::numeric_limits<double>::max();
+	Rounded s = AsRounded(c);
+	if(s.n==0) return std::numeric_limits<double>::max();
+	if(InsideCore(p,s)) return 0.;
+	return glm::max(glm::length(p-ClosestOnBoundary(p,s))-s.r,0.);
+}
+
+//ray from o along d against a convex polygon, counter clockwise, entering at t in [0,1]
+static bool RayConvex(glm::dvec2 o, glm::dvec2 d, const glm::dvec2 * pts, int n, double& t, glm::dvec2& normal){
+	double tin = 0., tout = 1.;
+	glm::dvec2 nin(0);
+	for(int i=0;i<n;i++){
+		glm::dvec2 e = pts[(i+1)%n]-pts[i];
+		glm::dvec2 out(e.y,-e.x);
+		double num = glm::dot(out,pts[i]-o);
+		double den = glm::dot(out,d);
+		if(den==0.){
+			if(num<0.) return false; //parallel, outside this edge
+			continue;
+		}
+		double s = num/den;
+		if(den<0.){ if(s>tin){ tin = s; nin = out; } }
+		else tout = glm::min(tout,s);
+		if(tin>tout) return false;
+	}
+	if(nin==glm::dvec2(0)) return false; //started inside, the caller knows
+	t = tin;
+	normal = glm::normalize(nin);
+	return true;
+}
+
+bool CollisionENG::RayShape(Collider * c, glm::dvec2 from, glm::dvec2 d, double& t, glm::dvec2& normal){
+	if(c->type==COLLIDER_NONE) return false;
+	Rounded s = AsRounded(c);
+	if(s.n==0) return false;
+	if(ShapeDistance(c,from)<=0.){
+		t = 0.;
+		double l = glm::length(d);
+		normal = (l>0.)? -d/l : glm::dvec2(1,0);
+		return true;
+	}
+	//a rounded shape is its core polygon, a circle on every point and a box along every edge
+	//tested in the shape's own frame, the normal is turned back at the end
+	glm::dvec2 o = s.Unturn(from-s.origin);
+	d = s.Unturn(d);
+	bool hit = false;
+	double ht;
+	glm::dvec2 hn;
+	auto keep = [&](double k, glm::dvec2 n){
+		if(!hit || k<t){ t = k; normal = n; hit = true; }
+	};
+	if(s.n>=3 && RayConvex(o,d,s.pts,s.n,ht,hn)) keep(ht,hn);
+	if(s.r>0.){
+		for(int i=0;i<s.n;i++)
+			if(SweptCircle(o-s.pts[i],d,s.r,ht)) keep(ht,glm::normalize(o+d*ht-s.pts[i]));
+		for(int i=0;i<s.Edges();i++){
+			glm::dvec2 a = s.pts[i], b = s.pts[(i+1)%s.n], e = b-a;
+			double l = glm::length(e);
+			if(l<=0.) continue;
+			glm::dvec2 side = glm::dvec2(-e.y,e.x)*(s.r/l);
+			glm::dvec2 box[4] = {a-side, b-side, b+side, a+side};
+			if(RayConvex(o,d,box,4,ht,hn)) keep(ht,hn);
+		}
+	}
+	if(hit) normal = s.Turn(normal);
+	return hit;
+}
+
+double CollisionENG::ObjectDistance(CollisionObj * o, glm::dvec2 p, LayerMask layers, Collider ** nearest){
+	double best = -1.;
+	for(auto c : o->colliders){
+		if(c->type==COLLIDER_NONE || c->layer<0 || c->layer>=MAX_LAYERS || !((layers>>c->layer)&1)) continue;
+		double d = ShapeDistance(c,p);
+		if(best<0. || d<best){
+			best = d;
+			if(nearest) *nearest = c;
+		}
+	}
+	return best;
+}
+
+int CollisionENG::Raycast(glm::dvec2 from, glm::dvec2 to, RayHit * hits, int max, LayerMask layers){
+	if(max<=0) return 0;
+	SyncTree();
+	int count = 0;
+	glm::dvec2 d = to-from;
+	tree.Raycast(from,to,[&](int id,double maxT){
+		CollisionObj * o = managed[id];
+		if(!(o->mask & layers)) return maxT;
+		RayHit h;
+		bool hit = false;
+		for(auto c : o->colliders){
+			if(c->layer<0 || c->layer>=MAX_LAYERS || !((layers>>c->layer)&1)) continue;
+			double t;
+			glm::dvec2 n;
+			if(RayShape(c,from,d,t,n) && t<=maxT && (!hit || t<h.t)){
+				h.collider = c;
+				h.t = t;
+				h.normal = n;
+				hit = true;
+			}
+		}
+		if(!hit) return maxT;
+		h.obj = o;
+		h.point = from+d*h.t;
+		//sorted insert, the farthest falls off a full buffer
+		int i = (count<max)? count++ : max-1;
+		while(i>0 && hits[i-1].t>h.t){ hits[i] = hits[i-1]; i--; }
+		hits[i] = h;
+		return (count==max)? hits[max-1].t : maxT; //past the farthest kept, nothing is wanted
+	});
+	return count;
+}
+
+int CollisionENG::OverlapCircle(glm::dvec2 center, double radius, CollisionObj ** out, int max, LayerMask layers){
+	if(max<=0) return 0;
+	SyncTree();
+	int count = 0;
+	tree.Query(center-glm::dvec2(radius),center+glm::dvec2(radius),[&](int id){
+		CollisionObj * o = managed[id];
+		if(!(o->mask & layers)) return true;
+		double d = ObjectDistance(o,center,layers);
+		if(d>=0. && d<=radius) out[count++] = o;
+		return count<max;
+	});
+	return count;
+}
+
+int CollisionENG::KNearest(glm::dvec2 point, int k, CollisionObj ** out, double * distances, LayerMask layers, double maxDistance){
+	if(k<=0) return 0;
+	SyncTree();
+	int count = 0;
+	tree.Nearest(point,maxDistance,[&](int id,double bound){
+		CollisionObj * o = managed[id];
+		double d = (o->mask & layers)? ObjectDistance(o,point,layers) : -1.;
+		if(d<0. || d>bound) return bound;
+		//sorted insert, the farthest falls off a full buffer
+		int i = (count<k)? count++ : k-1;
+		while(i>0 && distances[i-1]>d){
+			out[i] = out[i-1];
+			distances[i] = distances[i-1];
+			i--;
+		}
+		out[i] = o;
+		distances[i] = d;
+		return (count==k)? distances[k-1] : bound;
+	});
+	return count;
 }
 
 CollisionMsg::CollisionMsg(CollPair p, CollPair q, int l)
-: P(p), Q(q), layer(l), life(1) {}
+: P(p), Q(q), layer(l), qlayer(l), trigger(false), life(1), pid(-1), qid(-1) {}
 
 /*
 CollisionMsg CircleCollider::collision(CircleCollider g){
@@ -2,15 +2,33 @@
 #include "ENG/includes/glm/glm.hpp"
 #include "ENG/includes/glm/ext.hpp"
 #include "gameobj.h"
+#include "grid.h"
+#include "dtree.h"
+#include "jobs.h"
+#include "ecs.h"
 #include <algorithm>
+#include <limits>
+typedef unsigned int LayerMask; //bit l for layer l
+static const int MAX_LAYERS = 32;
+
 /**
 Single Colliders
 **/
+enum ColliderType {
+	COLLIDER_NONE,		//never collides
+	COLLIDER_CIRCLE,
+	COLLIDER_CAPSULE,
+	COLLIDER_POLYGON,	//convex
+	COLLIDER_TYPES		//count, size of CollisionENG::shapeTests
+};
+
 class Collider : public GameObj {
 public:
-	int layer;
+	int layer; //0 to MAX_LAYERS-1, what it meets is set by CollisionENG::Interact
+	ColliderType type = COLLIDER_NONE; //set by the shape, picks the test without RTTI
 	Collider()=default;
 	Collider(GameObj *,int);
+	double Reach(); //radius around its position holding the whole shape
 //	void Move(glm::dvec2 delta); //if has parent moves parent//move to gameObj
 };
 /*
@@ -23,58 +41,216 @@ public:
 class CircleCollider : public Collider {
 public:
 	double Dim(){return this->scale.x;}
-	void Dim(double s){this->scale = glm::dvec3(s);}
+	void Dim(double s){this->Scale(glm::dvec3(s));}
 	CircleCollider(GameObj* a,int l): Collider(a,l){
 		TESTLOG("CircleCollider Created for " TAB this->parent->name);
+		type = COLLIDER_CIRCLE;
 		scale = glm::vec3(1);
 	}
 	CircleCollider(GameObj* a,int l, float size): Collider(a,l){
 		TESTLOG("CircleCollider Created for " TAB this->parent->name);
+		type = COLLIDER_CIRCLE;
 		scale = glm::vec3(size);
 	}
 };
 
+/**
+Shapes below live in the xz plane, relative to their object: IndexColliders moves the
+collider's xz offset into them, they turn about the object with its yaw, like its model is drawn
+**/
+class CapsuleCollider : public Collider {
+public:
+	glm::dvec2 ends[2]; //segment
+	double radius;
+	CapsuleCollider(GameObj* a,int l, glm::dvec2 e0, glm::dvec2 e1, double r): Collider(a,l){
+		type = COLLIDER_CAPSULE;
+		ends[0] = e0;
+		ends[1] = e1;
+		radius = r;
+	}
+};
+
+class PolygonCollider : public Collider {
+public:
+	std::vector<glm::dvec2> points; //convex, counter clockwise
+	double reach = 0;
+	PolygonCollider(GameObj* a,int l, const std::vector<glm::dvec2>& cloud): Collider(a,l){
+		type = COLLIDER_POLYGON;
+		points = Hull(cloud);
+		for(auto& p : points) reach = glm::max(reach,glm::length(p));
+	}
+	static std::vector<glm::dvec2> Hull(std::vector<glm::dvec2>); //convex hull, counter clockwise
+};
+
 class CollisionObj : virtual public GameObj {
 public:
-	std::vector<Collider *> collidersLayer(int);
+	const std::vector<Collider *>& collidersLayer(int); //prebuilt, no allocation
 	void CreateCollider(glm::dvec3,int);
 	void CreateCollider(glm::dvec3 pos,int l, float size);
+	void CreateCapsuleCollider(glm::dvec3 pos,int l, glm::dvec2 e0, glm::dvec2 e1, double radius);
+	void CreatePolygonCollider(glm::dvec3 pos,int l, const std::vector<glm::dvec2>& points); //keeps their convex hull
+	template <typename V> void CreateHullCollider(const std::vector<V>& vertices,int l, double scale=1.){ //Mesh vertices, seen from above
+		std::vector<glm::dvec2> xz;
+		xz.reserve(vertices.size());
+		for(auto& v : vertices) xz.push_back(glm::dvec2(v.Position.x,v.Position.z)*scale);
+		CreatePolygonCollider(glm::dvec3(0),l,xz);
+	}
+	void ReleaseColliders(); //frees what the Create functions made, once out of the engine
 	void UpdateCollider(glm::dvec3 pos, int l, float size, int n);
+	void IndexColliders(); //after changing colliders by hand, Create/Update/Release call it
+	glm::dvec2 BoundCenter() {return worldPosition2D()+boundCenter;}
 //private:
 	std::vector<Collider *> colliders;
+	std::vector<std::vector<Collider *>> layers; //colliders by layer
+	LayerMask mask = 0; //layers having colliders
+	//circle around every collider, relative to the object, for early rejects
+	glm::dvec2 boundCenter = glm::dvec2(0);
+	double boundRadius = 0;
+	bool hasBound = false; //some collider can collide
+	int collId = -1; //index in CollisionENG::managed
+	bool sleeping = false; //set by PhyxENG, couples of sleepers are not tested
+};
+
+//how two colliders touch, computed once by the narrow phase
+struct Contact {
+	glm::dvec2 normal = glm::dvec2(1,0); //unit, from Q towards P
+	double penetration = 0; //overlap along normal
+	double distance = 0; //between the shape centers
+	double toi = 0; //swept tests only, fraction of the step where they first touch
+};
+
+//what CollisionENG::Raycast found, an object per hit by its nearest collider
+struct RayHit {
+	CollisionObj * obj = nullptr;
+	Collider * collider = nullptr;
+	double t = 0; //fraction of the ray, 0 when it starts inside
+	glm::dvec2 point = glm::dvec2(0);
+	glm::dvec2 normal = glm::dvec2(1,0); //unit, out of the shape, against the ray when it starts inside
 };
 
 using CollPair = std::pair<GameObj*,Collider*>;
 class CollisionMsg {
 public:
+	CollisionMsg()=default;
 	CollisionMsg(CollPair,CollPair,int);
 
 	int life; //in frames
-	int layer;
+	int layer; //of P's collider
+	int qlayer; //of Q's collider
+	bool trigger; //one of the layers is a trigger, reported but not resolved
 	CollPair P;
 	CollPair Q;
+	int pid, qid; //collId of P and Q
+	Contact contact; //of P.second and Q.second, as they were in the last Update
+};
+
+/**
+Events of one object and layer, read in place from CollisionENG::events
+valid until the next CollisionENG::Update
+**/
+class CollisionView {
+public:
+	struct iterator {
+		std::vector<CollisionMsg> * events;
+		const int * i;
+		CollisionMsg& operator*() const {return (*events)[*i];}
+		CollisionMsg* operator->() const {return &(*events)[*i];}
+		iterator& operator++() {i++; return *this;}
+		bool operator!=(const iterator& o) const {return i!=o.i;}
+	};
+	CollisionView(std::vector<CollisionMsg>& e, const std::vector<int>& i): events(&e), idx(&i) {}
+	iterator begin() const {return {events,idx->data()};}
+	iterator end() const {return {events,idx->data()+idx->size()};}
+	size_t size() const {return idx->size();}
+	bool empty() const {return idx->empty();}
+	CollisionMsg& operator[](size_t n) const {return (*events)[(*idx)[n]];}
+//private:
+	std::vector<CollisionMsg> * events;
+	const std::vector<int> * idx;
+};
+
+enum BroadPhase {
+	BruteForce,	//every couple is tested
+	Grid,		//spatial hash sized from the biggest CircleCollider
+	Tree		//dynamic AABB tree, for sizes too different for one cell size
 };
 
 class CollisionENG {
 public:
-	int LAYERS = 1;
+	int LAYERS = 1; //layers in use, from the managed colliders at every Update
+	LayerMask matrix[MAX_LAYERS]; //bit b of matrix[a], layers a and b collide
+	LayerMask triggers = 0; //layers whose collisions are reported but not resolved
 	std::vector<CollisionObj *> managed;
-	std::vector<CollisionMsg *> events;
+	std::vector<CollisionMsg> events; //stored by value, compacted every frame
+	std::vector<std::vector<int>> adjacency; //events of each object, at collId*LAYERS+layer of its collider
+	std::vector<int> noEvents;
+
+	BroadPhase broadphase = Grid;
+	SpatialHash grid;
+	AABBTree tree; //by collId, kept between frames, also answers the spatial queries whatever the broad phase
+	bool treeCurrent = false; //holds the boxes of the last Update, cleared when objects are added or removed
+	std::vector<int> sweepFast; //collIds Sweep replays
+	std::vector<std::pair<int,int>> candidates; //couples handed to the narrow phase
+	std::vector<glm::dvec2> boundsLo, boundsHi;
+	std::vector<char> hasBounds;
+	JobSystem * jobs = nullptr; //narrow phase runs on it when set
+	std::vector<std::vector<CollisionMsg>> chunkEvents;
+	//per frame counters
+	long pairsTotal = 0;
+	long pairsTested = 0;
+	long pairsCulled = 0;
 
+	CollisionENG(); //every layer meets itself only
+	void Interact(int a,int b,bool on=true); //both ways
+	void Trigger(int l,bool on=true);
+	LayerMask Reach(LayerMask) const; //layers meeting any of these
 	void Init(std::vector<GameObj*>*);
+	void Init(Registry&); //objects of the Collidable components
+	void Add(CollisionObj*); //takes the next collId
+	CollisionObj * Remove(CollisionObj*); //the last object takes its collId, returned; not while events are read
 	void Update();
-	std::vector<CollisionMsg *> EventsOf(GameObj *);
-	CollisionMsg * CollisionBetween(GameObj *, GameObj *,int);
-	CollisionMsg * CollisionWith(GameObj *,int);
-	std::vector<CollisionMsg *> CollisionsWith(GameObj*,int);
+	CollisionMsg * CollisionBetween(CollisionObj *, CollisionObj *,int);
+	CollisionMsg * CollisionWith(CollisionObj *,int);
+	CollisionView CollisionsWith(CollisionObj*,int);
+	const std::vector<int>& Adjacency(CollisionObj*,int);
+
+	//spatial queries, objects are looked up where the last Update saw them, their shapes where they are now
+	//results go in the caller's buffers, nothing is allocated once the tree is built; the count is returned
+	//only colliders on the given layers count; not from jobs, the tree has one traversal stack
+	int Raycast(glm::dvec2 from, glm::dvec2 to, RayHit * hits, int max, LayerMask layers=~0u); //nearest first
+	int OverlapCircle(glm::dvec2 center, double radius, CollisionObj ** out, int max, LayerMask layers=~0u);
+	int KNearest(glm::dvec2 point, int k, CollisionObj ** out, double * distances, LayerMask layers=~0u, double maxDistance=std::numeric_limits<double>::max()); //nearest first, out and distances hold k, the distances to their shapes are how they are ranked
 //private:
 	void CheckCollisions();//Generate Events //in update
+	void BroadPhasePairs(); //fills candidates
+	void FilterCandidates(); //drops the couples whose layers don't meet, and sleeping couples
+	void NarrowPhase(); //tests candidates, fills events
+	bool Bounds(CollisionObj*, glm::dvec2&, glm::dvec2&); //2D box around the bounding circle
+	static bool BoundsOverlap(CollisionObj*, CollisionObj*); //bounding circles touch, checked once for all layers
+	bool Interacts(CollisionObj*, CollisionObj*) const; //some layers of theirs meet, before any shape test
+	void Collide(CollisionObj*, CollisionObj*, std::vector<CollisionMsg>&); //an event per meeting couple of layers that touch
 	void CleanEvents(); //in update
+	void IndexEvents(); //in update, fills adjacency
+	void DropEvents(); //before collIds change
+	void SyncTree(); //brings the tree to the last Update for queries, when another broad phase ran
 
 
-	bool CircleCollision(CircleCollider*,CircleCollider*);
+	static bool CircleCollision(CircleCollider*,CircleCollider*,Contact&); //squared distances, one sqrt on hits
+	static bool ConvexCollision(Collider*,Collider*,Contact&); //SAT, every other couple of shapes
 	//add more for specific collider types
-	bool ColliderCollision(Collider*,Collider*); //last check for collidertypes
+	bool ColliderCollision(Collider*,Collider*,Contact&); //last check for collidertypes
+	typedef bool (*ShapeTest)(Collider*,Collider*,Contact&); //fills the contact when true
+	static const ShapeTest shapeTests[COLLIDER_TYPES][COLLIDER_TYPES]; //by type of both colliders, null never collides
+
+	bool Collision(CollisionObj*, CollisionObj*,int,int, CollisionMsg&); //P's layer and Q's, used by Collide
+
+	//continuous collisions, objects are where a step left them after moving by motion (by collId)
+	//couples having a fast one that started apart and touched on the way, soonest first
+	void Sweep(const std::vector<glm::dvec2>& motion, double fast, std::vector<CollisionMsg>& out); //fast in bounding radii per step, what they may have crossed comes from the tree
+	bool SweepColliders(CollisionObj*, CollisionObj*, glm::dvec2, glm::dvec2, CollisionMsg&); //earliest touch of their colliders
+	static bool SweptCircle(glm::dvec2 s, glm::dvec2 d, double r, double& t); //|s+d*t|==r first, t in ]0,1]
 
-	CollisionMsg * Collision(CollisionObj*, CollisionObj*,int); //used in CheckCollisions to fill events
+	static double ShapeDistance(Collider*, glm::dvec2 p); //to its surface, 0 inside
+	static bool RayShape(Collider*, glm::dvec2 from, glm::dvec2 d, double& t, glm::dvec2& normal); //first touch of from+d*t, t in [0,1]
+	double ObjectDistance(CollisionObj*, glm::dvec2 p, LayerMask layers, Collider ** nearest=nullptr); //to its nearest collider on layers, negative without any
 };
\ No newline at end of file
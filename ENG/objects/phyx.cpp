@@ -1,17 +1,78 @@
 #include "phyx.h"
 #include <iostream>
-static const int PHYX_LAYER=0;
+#include <cmath>
 
 void PhyxENG::Init(std::vector<GameObj*>* gameobjects, CollisionENG *ce,SoundENG *se){
+	for(auto p : managed) p->Unbind(); //bodies left out keep their state
 	managed.clear();
+	bodies.Clear();
+	components = nullptr;
 	for (unsigned int i = 0; i < gameobjects->size(); i++)
 	{
 		GameObj* go = gameobjects->at(i);
 		PhyxObj2D* cast = dynamic_cast<PhyxObj2D *>(go);
-		if(cast) managed.push_back(cast);
+		if(cast){
+			managed.push_back(cast);
+			cast->Bind(&bodies);
+		}
 	}
+	Link(ce,se);
+}
+
+void PhyxENG::Init(Registry& registry, CollisionENG *ce,SoundENG *se){
+	for(auto p : managed) p->Unbind();
+	managed.clear();
+	bodies.Clear();
+	components = &registry.Components<RigidBody2D>();
+	registry.Query<RigidBody2D>().Each([this](Entity, RigidBody2D& rb){
+		managed.push_back(rb.body);
+		rb.body->Bind(&bodies);
+		rb.index = rb.body->body;
+	});
+	Link(ce,se);
+}
+
+void PhyxENG::Link(CollisionENG *ce,SoundENG *se){
 	collisionENG = ce;
 	soundENG = se;
+	//collision events only know collIds, keep the way back to the bodies
+	byCollId.assign(ce->managed.size(),nullptr);
+	for(auto p : managed)
+		if(p->collId>=0 && p->collId<byCollId.size()) byCollId[p->collId] = p;
+}
+
+void PhyxENG::Add(PhyxObj2D* p){
+	if(p->store) return;
+	managed.push_back(p);
+	p->Bind(&bodies);
+	Index(p);
+	if(p->collId>=0) Relink(p->collId,p);
+}
+
+void PhyxENG::Index(PhyxObj2D* p){
+	if(components && components->Has(p->entity)) components->Get(p->entity).index = p->body;
+}
+
+void PhyxENG::Remove(PhyxObj2D* p){
+	int i = p->body;
+	if(p->store!=&bodies || i<0 || i>=managed.size() || managed[i]!=p) return;
+	p->Unbind();
+	Index(p);
+	bodies.Remove(i);
+	managed[i] = managed.back();
+	managed[i]->body = i;
+	Index(managed[i]);
+	managed.pop_back();
+	if(p->collId>=0 && p->collId<byCollId.size() && byCollId[p->collId]==p) byCollId[p->collId] = nullptr;
+	//its colliders' addresses may come back with other bodies
+	auto own = [p](Collider* c){ return std::find(p->colliders.begin(),p->colliders.end(),c)!=p->colliders.end(); };
+	warm.erase(std::remove_if(warm.begin(),warm.end(),[&](const CachedImpulse& w){ return own(w.a) || own(w.b); }),warm.end());
+}
+
+void PhyxENG::Relink(int collId, PhyxObj2D* p){
+	if(collId<0) return;
+	if(collId>=byCollId.size()) byCollId.resize(collId+1,nullptr);
+	byCollId[collId] = p;
 }
 
 void PhyxENG::Update(){
@@ -26,166 +87,511 @@ void PhyxENG::Update(){
 		framecounter = 0;
 		timecounter-=1.;
 	}
+
+	if(!fixedstep){
+		accumulator = 0;
+		alpha = 1;
+		Step(dd);
+		return;
+	}
+	accumulator += dd;
+	int steps=0;
+	while(accumulator>=step && steps<maxSubsteps){
+		if(steps) collisionENG->Update(); //the first step uses the events of this frame
+		Step(step);
+		accumulator -= step;
+		steps++;
+	}
+	//too far behind, drop the time rather than spiral
+	if(accumulator>=step) accumulator = std::fmod(accumulator,step);
+	alpha = accumulator/step;
+}
+
+void PhyxENG::Step(double dd){
 	framecounter++;
+	ApplyGravity();
+
+	supported.assign(bodies.Size(),0);
+	//only couples the collision engine reported are looked at
+	int cols = clipping? GatherContacts() : 0;
+	if(cols) SolveContacts(dd);
+	if(cols) Gather(); //resolutions moved bodies around
+	//every couple has been seen, objects are done working
+	bool sweep = ccd && clipping && collisionENG;
+	if(sweep){
+		startX = bodies.x;
+		startY = bodies.y;
+	}
+	Integrate(dd);
+	if(sweep) ContinuousCollisions(dd);
+	if(cols) TESTLOG("collisions managed" TAB cols);
+//	 std::cout<<"collision count"<<cols<<std::endl;
+}
+
+void PhyxENG::ContinuousCollisions(double dt){
+	RigidBodies& b = bodies;
+	sweepMotion.assign(collisionENG->managed.size(),glm::dvec2(0));
+	for(int i=0;i<managed.size();i++){
+		int c = managed[i]->collId;
+		if(c>=0 && c<sweepMotion.size()) sweepMotion[c] = glm::dvec2(b.x[i]-startX[i],b.y[i]-startY[i]);
+	}
+	collisionENG->Sweep(sweepMotion,ccdThreshold,impacts);
+	if(impacts.empty()) return;
+	swept.assign(managed.size(),0);
+	int hits = 0;
+	for(auto& e : impacts){
+		if(e.trigger || !((layers>>e.layer)&1) || !((layers>>e.qlayer)&1)) continue;
+		PhyxObj2D * p = (e.pid<byCollId.size())? byCollId[e.pid] : nullptr;
+		PhyxObj2D * q = (e.qid<byCollId.size())? byCollId[e.qid] : nullptr;
+		if(!p || !q) continue;
+		if(swept[p->body] || swept[q->body]) continue; //already replayed, its motion isn't the swept one anymore
+		swept[p->body] = swept[q->body] = 1;
+		TESTLOG("PhyxENG::ContinuousCollisions" TAB p->name TAB q->name TAB e.contact.toi);
+		//back to where they touched, bounce, and the rest of the step with the new velocities
+		double rest = 1.-e.contact.toi;
+		if(!p->isKinematic()) p->Move(sweepMotion[e.pid]*-rest);
+		if(!q->isKinematic()) q->Move(sweepMotion[e.qid]*-rest);
+		DynamicResolution(p,q,e.contact);
+		if(!p->isKinematic()) p->Move(p->V()*(dt*rest));
+		if(!q->isKinematic()) q->Move(q->V()*(dt*rest));
+		hits++;
+	}
+	if(hits) Gather();
+}
+
+int PhyxENG::GatherContacts(){
+	contacts.clear();
+	for(auto& pqData : collisionENG->events){ //each couple once
+		if(pqData.trigger || !((layers>>pqData.layer)&1) || !((layers>>pqData.qlayer)&1)) continue;
+		PhyxObj2D * p = (pqData.pid<byCollId.size())? byCollId[pqData.pid] : nullptr;
+		PhyxObj2D * q = (pqData.qid<byCollId.size())? byCollId[pqData.qid] : nullptr;
+		if(!p || !q) continue;
+
+		TESTLOG("PhyxENG::GatherContacts collision detected" TAB p->name TAB q->name);
+		//a moving body wakes what it hits
+		if(p->Speed()>sleepSpeed) q->Wake();
+		if(q->Speed()>sleepSpeed) p->Wake();
+		if(soundENG && glm::length(glm::dot(p->V(),q->V()))>0.1){
+				soundENG->Play(2, false);
+			}
+		SolverContact c;
+		c.p = p;
+		c.q = q;
+		c.cp = pqData.P.second;
+		c.cq = pqData.Q.second;
+		c.contact = pqData.contact;
+		//sleepers still awake after the checks above hold like kinematic bodies, warm impulses included
+		c.invMassP = (p->isKinematic() || p->isAsleep() || p->Mass()<=0.)? 0. : 1./p->Mass();
+		c.invMassQ = (q->isKinematic() || q->isAsleep() || q->Mass()<=0.)? 0. : 1./q->Mass();
+		if(c.invMassP+c.invMassQ<=0.) continue; //what happens an unstoppable force meets an immovable object ?
+		c.normalMass = 1./(c.invMassP+c.invMassQ);
+		double approach = glm::dot(p->V()-q->V(),c.contact.normal);
+		c.target = (approach < -bounceSpeed)? -approach*colEl : 0.;
+		c.impulse = 0;
+		contacts.push_back(c);
+	}
+	return contacts.size();
+}
+
+double PhyxENG::WarmImpulse(Collider* p, Collider* q){
+	CachedImpulse key;
+	key.a = std::min(p,q);
+	key.b = std::max(p,q);
+	auto it = std::lower_bound(warm.begin(),warm.end(),key);
+	return (it!=warm.end() && it->a==key.a && it->b==key.b)? it->impulse : 0.;
+}
+
+void PhyxENG::ApplyImpulse(SolverContact& c, double j){
+	if(j==0.) return;
+	glm::dvec2 n = c.contact.normal*j;
+	if(c.invMassP>0.) c.p->Kick(n*c.invMassP);
+	if(c.invMassQ>0.) c.q->Kick(n*-c.invMassQ);
+}
 
-	int cols=0;
+void PhyxENG::SolveContacts(double dt){
+	//the impulses of the last step are most of the answer for contacts that lasted
+	for(auto& c : contacts){
+		c.impulse = warmStarting? WarmImpulse(c.cp,c.cq) : 0.;
+		ApplyImpulse(c,c.impulse);
+	}
+	//solved on the velocities the step will integrate with, forces included, so resting piles stay at rest
+	for(int it=0;it<solverIterations;it++)
+		for(auto& c : contacts){
+			double vn = glm::dot(c.p->V()-c.q->V() + (c.p->A()-c.q->A())*dt,c.contact.normal);
+			double total = glm::max(c.impulse + c.normalMass*(c.target-vn),0.); //contacts push, never pull
+			ApplyImpulse(c,total-c.impulse);
+			c.impulse = total;
+		}
+	warmNext.clear();
+	for(auto& c : contacts){
+		CachedImpulse w;
+		w.a = std::min(c.cp,c.cq);
+		w.b = std::max(c.cp,c.cq);
+		w.impulse = c.impulse;
+		warmNext.push_back(w);
+	}
+	std::sort(warmNext.begin(),warmNext.end());
+	warmNext.erase(std::unique(warmNext.begin(),warmNext.end()),warmNext.end()); //a couple the narrow phase reported twice
+	warm.swap(warmNext);
+	//what a contact holds up may rest under its load, see UpdateSleep
+	auto hold = [this](PhyxObj2D* p){
+		PhyxObj2D* m = p->parent? p->ParentBody() : p; //attached bodies push their parent
+		if(m && m->store==&bodies) supported[m->body] = 1;
+	};
+	for(auto& c : contacts) if(c.impulse>0.){
+		hold(c.p);
+		hold(c.q);
+	}
+	//velocities are solved, the overlaps are pushed out once
+	for(auto& c : contacts) StaticResolution(c.p,c.q,c.contact);
+}
+
+void PhyxENG::Gather(){
+	RigidBodies& b = bodies;
 	for(int i=0;i<managed.size();i++){
+		glm::dvec2 w = managed[i]->worldPosition2D();
+		b.x[i] = w.x;
+		b.y[i] = w.y;
+		if(managed[i]->parent) b.flags[i] |= BODY_ATTACHED;
+		else b.flags[i] &= ~BODY_ATTACHED;
+	}
+}
+
+void PhyxENG::Integrate(double dt){
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	if(integrator == VelocityVerlet) VerletStep(dt);
+	else if(integrator == RungeKutta4) RK4Step(dt);
+	else EulerStep(dt);
+	const unsigned char *flags = b.flags.data();
+	for(int i=0;i<n;i++){
+		PhyxObj2D * p = managed[i];
+		if(flags[i]==0){
+			p->Previous(p->position, true);
+			p->Position(glm::dvec3(b.x[i],p->position.y,b.y[i]));
+		} else if(flags[i]==BODY_ATTACHED) p->dV(glm::dvec2(b.ax[i],b.ay[i])*dt); //pushes the parent
+	}
+	UpdateSleep();
+	std::fill(b.ax.begin(),b.ax.end(),0.);
+	std::fill(b.ay.begin(),b.ay.end(),0.);
+}
+
+void PhyxENG::UpdateSleep(){
+	RigidBodies& b = bodies;
+	double v2 = sleepSpeed*sleepSpeed, a2 = sleepAccel*sleepAccel;
+	active = 0;
+	for(int i=0;i<b.Size();i++){
+		if(b.flags[i]&BODY_ASLEEP){
+			//gravity is still computed for sleepers, enough of a change from what held them wakes them
+			double dx = b.ax[i]-b.restAx[i], dy = b.ay[i]-b.restAy[i];
+			if(sleeping && dx*dx+dy*dy <= a2) continue;
+			managed[i]->Wake();
+		}
+		active++;
+		if(b.flags[i] || !sleeping){
+			b.idle[i] = 0;
+			continue;
+		}
+		//a body its contacts hold up is still under any load, a free one only without one
+		bool held = i<supported.size() && supported[i];
+		bool still = b.vx[i]*b.vx[i]+b.vy[i]*b.vy[i] < v2 && (held || b.ax[i]*b.ax[i]+b.ay[i]*b.ay[i] < a2);
+		b.idle[i] = still? b.idle[i]+1 : 0;
+		if(b.idle[i]>=sleepSteps){
 			PhyxObj2D * p = managed[i];
-		for(int j=i+1;j<managed.size();j++){ //this kind of loop allows us to only check a couple once
+			b.flags[i] |= BODY_ASLEEP;
+			b.vx[i] = b.vy[i] = 0;
+			b.restAx[i] = held? b.ax[i] : 0.;
+			b.restAy[i] = held? b.ay[i] : 0.;
+			p->Previous(p->position, p->interpolated);
+			p->sleeping = true;
+			active--;
+		}
+	}
+}
+
+void PhyxENG::EulerStep(double dt){
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	double *x = b.x.data(), *y = b.y.data();
+	double *vx = b.vx.data(), *vy = b.vy.data();
+	double *ax = b.ax.data(), *ay = b.ay.data();
+	const unsigned char *flags = b.flags.data();
+	//kinematic and attached bodies don't move by themselves, masked rather than skipped
+	for(int i=0;i<n;i++){
+		double h = (flags[i]==0)? dt : 0.;
+		vx[i] += ax[i]*h;
+		vy[i] += ay[i]*h;
+		x[i] += vx[i]*h;
+		y[i] += vy[i]*h;
+	}
+}
+
+void PhyxENG::VerletStep(double dt){
+	//half kick, drift, half kick with the gravity of the new positions
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	double *x = b.x.data(), *y = b.y.data();
+	double *vx = b.vx.data(), *vy = b.vy.data();
+	double *ax = b.ax.data(), *ay = b.ay.data();
+	const unsigned char *flags = b.flags.data();
+	for(int i=0;i<n;i++){
+		double h = (flags[i]==0)? dt : 0.;
+		vx[i] += ax[i]*h*.5;
+		vy[i] += ay[i]*h*.5;
+		x[i] += vx[i]*h;
+		y[i] += vy[i]*h;
+	}
+	stageAx.resize(n);
+	stageAy.resize(n);
+	GravityAt(x,y,stageAx.data(),stageAy.data());
+	//forces other than gravity are held over the step
+	for(int i=0;i<n;i++){
+		double h = (flags[i]==0)? dt : 0.;
+		vx[i] += (ax[i]-gravAx[i]+stageAx[i])*h*.5;
+		vy[i] += (ay[i]-gravAy[i]+stageAy[i])*h*.5;
+	}
+}
+
+void PhyxENG::RK4Step(double dt){
+	//classic Runge-Kutta on (x,v), gravity evaluated at every stage
+	//forces other than gravity are held over the step
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	double *x = b.x.data(), *y = b.y.data();
+	double *vx = b.vx.data(), *vy = b.vy.data();
+	double *ax = b.ax.data(), *ay = b.ay.data();
+	const unsigned char *flags = b.flags.data();
+	for(auto v : {&stageX,&stageY,&stageAx,&stageAy,&kx,&ky,&kvx,&kvy,&sumX,&sumY,&sumVx,&sumVy}) v->resize(n);
+	for(int i=0;i<n;i++){
+		kx[i] = sumX[i] = vx[i];
+		ky[i] = sumY[i] = vy[i];
+		kvx[i] = sumVx[i] = ax[i];
+		kvy[i] = sumVy[i] = ay[i];
+	}
+	for(int s=0;s<3;s++){
+		double c = (s<2)? .5 : 1.;
+		double w = (s<2)? 2. : 1.;
+		for(int i=0;i<n;i++){
+			double h = (flags[i]==0)? dt*c : 0.;
+			stageX[i] = x[i] + kx[i]*h;
+			stageY[i] = y[i] + ky[i]*h;
+			kx[i] = vx[i] + kvx[i]*h;
+			ky[i] = vy[i] + kvy[i]*h;
+		}
+		GravityAt(stageX.data(),stageY.data(),stageAx.data(),stageAy.data());
+		for(int i=0;i<n;i++){
+			kvx[i] = ax[i]-gravAx[i]+stageAx[i];
+			kvy[i] = ay[i]-gravAy[i]+stageAy[i];
+			sumX[i] += w*kx[i];
+			sumY[i] += w*ky[i];
+			sumVx[i] += w*kvx[i];
+			sumVy[i] += w*kvy[i];
+		}
+	}
+	for(int i=0;i<n;i++){
+		double h = (flags[i]==0)? dt/6. : 0.;
+		x[i] += sumX[i]*h;
+		y[i] += sumY[i]*h;
+		vx[i] += sumVx[i]*h;
+		vy[i] += sumVy[i]*h;
+	}
+}
+
+void PhyxENG::ApplyGravity(){
+	Gather();
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	gravAx.resize(n);
+	gravAy.resize(n);
+	//kept apart from the other forces, the integrators re-evaluate it
+	GravityAt(b.x.data(),b.y.data(),gravAx.data(),gravAy.data());
+	if(gravitymode == Everything){
+		for(int i=0;i<n;i++){
+			b.ax[i] += gravAx[i];
+			b.ay[i] += gravAy[i];
+		}
+		return;
+	}
+	if(gravitymode == None) return;
+
+	for(int i=0;i<managed.size();i++){
+			PhyxObj2D * p = managed[i];
+		for(int j=i+1;j<managed.size();j++){
 			PhyxObj2D * q = managed[j];
 			
 			//Global Forces between all objects
 			//maybe give the PhyxENG settings to toggle these
-			glm::dvec2 g = PhyxENG::Gravity2D(p,q);
 			if(p->parent==nullptr){
-			if(gravitymode == Everything){
-				TESTLOG("PhyxENG::Update Gravity Between" TAB p->name TAB q->name TAB glm::length(g));
-				if(!p->isKinematic()) p->AddForce(g);
-				if(!q->isKinematic()) q->AddForce(-g);
-			} else if(gravitymode == Orbiting){
+			if(gravitymode == Orbiting){
+				glm::dvec2 g = PhyxENG::Gravity2D(p,q);
 				TESTLOG("PhyxENG::Update Gravity Between" TAB p->name TAB q->name TAB glm::length(g));
 				if(p->Orbiting(q) && !p->isKinematic()) p->AddForce(g);
 				if(q->Orbiting(p) && !q->isKinematic()) q->AddForce(-g);
 			} else if (gravitymode == Directional){
-				p->AddForce(glm::dvec2(0,-1)*p->mass);
-			}
+				p->AddForce(glm::dvec2(0,-1)*p->Mass());
 			}
-
-			CollisionMsg * pqData = collisionENG->CollisionBetween(p,q,PHYX_LAYER);
-			if(pqData && clipping){
-				TESTLOG("PhyxENG::Update collision detected" TAB p->name TAB q->name);
-				cols++;
-				if(soundENG && glm::length(glm::dot(p->v,q->v))>0.1){
-						soundENG->Play(2, false);
-					}
-//				if(!p->isKinematic()) p->AddForce(-g);
-//				if(!q->isKinematic()) q->AddForce(g);
-//				if(p->orbiting = q) p->AddForce(-g);
-				TESTLOG("p mass:" TAB p->Mass() TAB "q mass" TAB q->Mass() TAB p->Mass()-q->Mass());
-				TESTLOG("p speed:" TAB p->Speed() TAB "q speed" TAB q->Speed() TAB glm::dot(p->V(),q->V()));
-				StaticResolution(p,pqData->P.second, q,pqData->Q.second);
-				DynamicResolution(p,pqData->P.second, q,pqData->Q.second);
-				TESTLOG("p speed:" TAB p->Speed() TAB "q speed" TAB q->Speed() TAB glm::dot(p->V(),q->V()));
 			}
 		}
-		//now that i has seen all the other phyxObj, he's finished working
-		if(!p->isKinematic()) p->Update(dd);
-		p->ResetA();
 	}
-	if(cols) TESTLOG("collisions managed" TAB cols);
-//	 std::cout<<"collision count"<<cols<<std::endl;
 }
 
-void PhyxENG::StaticResolution(Collider *p,Collider *q){
-//	TESTLOG("PhyxENG::StaticResolution");
-	glm::dvec2 p2q = p->worldPosition2D() - q->worldPosition2D();
-	glm::dvec2 nor = glm::normalize(p2q);
-
-	CircleCollider *pc = dynamic_cast<CircleCollider *>(p);
-	CircleCollider *qc = dynamic_cast<CircleCollider *>(q);
-	if(pc&&qc){
-		double overlap = (pc->Dim() + qc->Dim())-glm::length(p2q);
-		p->Move(nor * overlap*.5);
-		q->Move(nor*-1. * overlap*.5);
+void PhyxENG::GravityAt(const double *x, const double *y, double *gx, double *gy){
+	int n = bodies.Size();
+	if(gravitymode == Everything){
+		if(gravitysolver == BarnesHut) TreeGravity(x,y,gx,gy);
+		else PairwiseGravity(x,y,gx,gy);
 	} else {
-		//at least try
-		p->Move(nor);
-		q->Move(nor*-1.);
+		std::fill(gx,gx+n,0.);
+		std::fill(gy,gy+n,0.);
 	}
+}
 
+void PhyxENG::PairwiseGravity(const double *x, const double *y, double *gx, double *gy){
+	//attached bodies neither attract nor get attracted, they move with their parent
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	gravMass.resize(n);
+	for(int i=0;i<n;i++) gravMass[i] = (b.flags[i]&BODY_ATTACHED)? 0. : b.mass[i];
+	//every row is computed on its own, whichever thread runs it
+	auto rows = [&](int begin,int end){
+		GravityKernel(simd,begin,end,n,x,y,gravMass.data(),G,gx,gy);
+	};
+	if(jobs) jobs->ParallelFor(n,64,rows);
+	else rows(0,n);
+	for(int i=0;i<n;i++) if(b.flags[i]&(BODY_KINEMATIC|BODY_ATTACHED)) gx[i] = gy[i] = 0.;
 }
-void PhyxENG::StaticResolution(PhyxObj2D* p, Collider * pc,PhyxObj2D*q, Collider *qc){
-	TESTLOG("PhyxENG::StaticResolution" TAB p->name TAB q->name);
-	glm::dvec2 p2q = pc->worldPosition2D() - qc->worldPosition2D();
-	glm::dvec2 nor = glm::normalize(p2q);
-	double p2qMassRatio = p->mass / (p->mass+q->mass);
-	double q2pMassRatio = q->mass / (p->mass+q->mass);
-
-	CircleCollider *pcc = dynamic_cast<CircleCollider *>(pc);
-	CircleCollider *qcc = dynamic_cast<CircleCollider *>(qc);
-	if(pcc&&qcc){
-		double overlap = ((pcc->Dim() + qcc->Dim())-glm::length(p2q))*1.01;
-		if(!p->isKinematic() && !q->isKinematic()){
-//			TESTLOG("normal collision");
-			p->Move(nor * overlap * q2pMassRatio);
-			q->Move(nor*-1. * overlap * p2qMassRatio);
-		}
-		else if((p->isKinematic() || q->Orbiting(p)) && !q->isKinematic()){
-			q->Move(nor*-1. * overlap);
-		}
-		else if(!p->isKinematic() && (q->isKinematic()|| p->Orbiting(q))){
-			p->Move(nor * overlap);
-		} else {
-			//what happens an unstoppable force
-			//meets and immovable object ? 
+
+void PhyxENG::TreeGravity(const double *x, const double *y, double *gx, double *gy){
+	//only free bodies take part, attached ones move with their parent
+	RigidBodies& b = bodies;
+	int n = b.Size();
+	std::fill(gx,gx+n,0.);
+	std::fill(gy,gy+n,0.);
+	treeBodies.clear();
+	treePos.clear();
+	treeMass.clear();
+	for(int i=0;i<n;i++) if(!(b.flags[i]&BODY_ATTACHED)){
+		treeBodies.push_back(i);
+		treePos.push_back(glm::dvec2(x[i],y[i]));
+		treeMass.push_back(b.mass[i]);
+	}
+	qtree.Build(treePos,treeMass);
+	auto walk = [&](int begin,int end){
+		for(int i=begin;i<end;i++){
+			int k = treeBodies[i];
+			if(b.flags[k]&BODY_KINEMATIC) continue;
+			glm::dvec2 acc = qtree.Acceleration(i,theta,G);
+			gx[k] = acc.x;
+			gy[k] = acc.y;
 		}
+	};
+	if(jobs) jobs->ParallelFor(treeBodies.size(),64,walk);
+	else walk(0,treeBodies.size());
+}
+
+void PhyxENG::StaticResolution(Collider *p,Collider *q,const Contact& c){
+//	TESTLOG("PhyxENG::StaticResolution");
+	p->Move(c.normal * c.penetration*.5);
+	q->Move(c.normal*-1. * c.penetration*.5);
+}
+void PhyxENG::StaticResolution(PhyxObj2D* p,PhyxObj2D*q,const Contact& c){
+	TESTLOG("PhyxENG::StaticResolution" TAB p->name TAB q->name);
+	glm::dvec2 nor = c.normal;
+	double overlap = glm::max(c.penetration-slop,0.)*correction; //the slop keeps resting contacts touching
+	double p2qMassRatio = p->Mass() / (p->Mass()+q->Mass());
+	double q2pMassRatio = q->Mass() / (p->Mass()+q->Mass());
+
+	if(!p->isKinematic() && !q->isKinematic()){
+//		TESTLOG("normal collision");
+		p->Move(nor * overlap * q2pMassRatio);
+		q->Move(nor*-1. * overlap * p2qMassRatio);
+	}
+	else if((p->isKinematic() || q->Orbiting(p)) && !q->isKinematic()){
+		q->Move(nor*-1. * overlap);
+	}
+	else if(!p->isKinematic() && (q->isKinematic()|| p->Orbiting(q))){
+		p->Move(nor * overlap);
 	} else {
-		//at least try
-		p->Move(nor);
-		q->Move(nor*-1.);
+		//what happens an unstoppable force
+		//meets and immovable object ? 
 	}
 }
 
-void PhyxENG::DynamicResolution(PhyxObj2D* p, Collider * pc,PhyxObj2D*q, Collider *qc){
+void PhyxENG::DynamicResolution(PhyxObj2D* p,PhyxObj2D*q,const Contact& c){
 	TESTLOG("PhyxENG::DynamicResolution" TAB p->name TAB q->name);
-	glm::dvec2 p2q = pc->worldPosition2D() - qc->worldPosition2D();
-	glm::dvec2 nor = glm::normalize(p2q);
-	TESTLOG(p->name<<"Collider(x,y)" TAB pc->worldPosition2D().x TAB pc->worldPosition2D().y);
-	TESTLOG(q->name<<"Collider(x,y)" TAB qc->worldPosition2D().x TAB qc->worldPosition2D().y);
+	glm::dvec2 nor = c.normal;
 	TESTLOG("Collision Normal (x,y)->" TAB nor.x TAB nor.y);
+	if(glm::dot(p->V()-q->V(),nor) >= 0.) return; //already parting, a bounce would send them back into each other
 
+	glm::dvec2 tan = glm::dvec2(nor.y*-1.,nor.x);
+	TESTLOG("Collision Tangent (x,y)->" TAB tan.x TAB tan.y);
 
-	CircleCollider *pcc = dynamic_cast<CircleCollider *>(pc);
-	CircleCollider *qcc = dynamic_cast<CircleCollider *>(qc);
-	if(pcc&&qcc){
-		TESTLOG("Circle Resolution");
-		glm::dvec2 tan = glm::vec2(nor.y*-1.,nor.x);
-		TESTLOG("Collision Tangent (x,y)->" TAB tan.x TAB tan.y);
-//		if(!p->isKinematic() && !q->isKinematic()){
-			
-			double pdottan = glm::dot(p->V(),tan);
-			double qdottan = glm::dot(q->V(),tan);
-			double pdotnor = glm::dot(p->V(),nor);
-			double qdotnor = glm::dot(q->V(),nor);
-
-			double pmomentum = (pdotnor*(p->mass - q->mass) + 2.*q->mass*qdotnor)/(p->mass+q->mass);
-			double qmomentum = (qdotnor*(q->mass - p->mass) + 2.*p->mass*pdotnor)/(p->mass+q->mass);
-
-			TESTLOG(p->name<<"NormalMomentum(x,y)->" TAB pmomentum);
-			TESTLOG(q->name<<"NormalMomentum(x,y)->" TAB qmomentum);
-
-			if(!p->isKinematic()) p->V((tan*pdottan + nor*pmomentum)*colEl);
-			if(!q->isKinematic()) q->V((tan*qdottan + nor*qmomentum)*colEl);
+	double pdottan = glm::dot(p->V(),tan);
+	double qdottan = glm::dot(q->V(),tan);
+	double pdotnor = glm::dot(p->V(),nor);
+	double qdotnor = glm::dot(q->V(),nor);
 
-/*		} else if((p->isKinematic() || q->orbiting==p) && !q->isKinematic()){
-			double dot = glm::dot(tan,q->V());
-			q->XV(tan.x*dot*colEl);
-			q->YV(tan.y*dot*colEl);
+	double pmomentum = (pdotnor*(p->Mass() - q->Mass()) + 2.*q->Mass()*qdotnor)/(p->Mass()+q->Mass());
+	double qmomentum = (qdotnor*(q->Mass() - p->Mass()) + 2.*p->Mass()*pdotnor)/(p->Mass()+q->Mass());
 
-		} else if(!p->isKinematic() && (q->isKinematic()|| p->orbiting==q)){
-			double dot = glm::dot(tan,p->V());
-			p->XV(tan.x*dot*colEl);
-			p->YV(tan.y*dot*colEl);
-		}*/
+	TESTLOG(p->name<<"NormalMomentum(x,y)->" TAB pmomentum);
+	TESTLOG(q->name<<"NormalMomentum(x,y)->" TAB qmomentum);
 
-	} else {
-		//at least try
-		p->ResetV();
-		q->ResetV();
-		p->ResetA();
-		q->ResetA();
-	}
+	if(!p->isKinematic()) p->V((tan*pdottan + nor*pmomentum)*colEl);
+	if(!q->isKinematic()) q->V((tan*qdottan + nor*qmomentum)*colEl);
 }
 
 glm::dvec2 PhyxENG::Gravity2D(PhyxObj2D* a,PhyxObj2D* b) {
 	glm::dvec2 a2b = b->worldPosition2D() - a->worldPosition2D();
 //	float G = ;//6.67408/100000000000.;
 	double Mm = a->Mass()*b->Mass();
-	double d = glm::length(a2b);
-	double r2 = (d*d)/4.f;
+	double r2 = glm::dot(a2b,a2b)/4.; //no sqrt, the law only needs d*d
 	return a2b*(G*(Mm/r2));
 }
 
+int RigidBodies::Add(glm::dvec2 v, glm::dvec2 a, double m, unsigned char f){
+	x.push_back(0);
+	y.push_back(0);
+	vx.push_back(v.x);
+	vy.push_back(v.y);
+	ax.push_back(a.x);
+	ay.push_back(a.y);
+	mass.push_back(m);
+	flags.push_back(f);
+	idle.push_back(0);
+	restAx.push_back(0);
+	restAy.push_back(0);
+	return Size()-1;
+}
+
+void RigidBodies::Remove(int i){
+	int last = Size()-1;
+	x[i] = x[last]; y[i] = y[last];
+	vx[i] = vx[last]; vy[i] = vy[last];
+	ax[i] = ax[last]; ay[i] = ay[last];
+	mass[i] = mass[last];
+	flags[i] = flags[last];
+	idle[i] = idle[last];
+	restAx[i] = restAx[last]; restAy[i] = restAy[last];
+	x.pop_back(); y.pop_back();
+	vx.pop_back(); vy.pop_back();
+	ax.pop_back(); ay.pop_back();
+	mass.pop_back();
+	flags.pop_back();
+	idle.pop_back();
+	restAx.pop_back(); restAy.pop_back();
+}
+
+void RigidBodies::Clear(){
+	x.clear(); y.clear();
+	vx.clear(); vy.clear();
+	ax.clear(); ay.clear();
+	mass.clear();
+	flags.clear();
+	idle.clear();
+	restAx.clear(); restAy.clear();
+}
+
 PhyxObj2D::PhyxObj2D()
 {
 	a = glm::dvec2(0.0f);
@@ -193,75 +599,129 @@ PhyxObj2D::PhyxObj2D()
 	mass = 1.0f;
 }
 
+void PhyxObj2D::Bind(RigidBodies* s){
+	if(store) Unbind();
+	body = s->Add(v,a,mass,kinematic? BODY_KINEMATIC : 0);
+	store = s;
+}
+
+void PhyxObj2D::Unbind(){
+	if(!store) return;
+	v = glm::dvec2(store->vx[body],store->vy[body]);
+	a = glm::dvec2(store->ax[body],store->ay[body]);
+	mass = store->mass[body];
+	kinematic = store->flags[body]&BODY_KINEMATIC;
+	sleeping = false;
+	store = nullptr;
+	body = -1;
+}
+
+void PhyxObj2D::isKinematic(bool b){
+	kinematic=b;
+	if(store){
+		if(b) store->flags[body] |= BODY_KINEMATIC;
+		else store->flags[body] &= ~BODY_KINEMATIC;
+	}
+}
+
+void PhyxObj2D::Wake(){
+	sleeping = false;
+	if(!store) return;
+	store->flags[body] &= ~BODY_ASLEEP;
+	store->idle[body] = 0;
+}
 
 void PhyxObj2D::Update(double dt){
-	dV(a * dt);
-	if(!parent) Move(v*dt);
+	dV(A() * dt);
+	if(!parent) Move(V()*dt);
 //	if(Speed()<0.00001) v=glm::vec2(0,0);
 }
-void PhyxObj2D::ResetA(){a=glm::vec2(0);}
-void PhyxObj2D::ResetV(){v=glm::vec2(0);}
+void PhyxObj2D::ResetA(){
+	if(store) store->ax[body] = store->ay[body] = 0;
+	else a=glm::vec2(0);
+}
+void PhyxObj2D::ResetV(){V(glm::dvec2(0));}
 void PhyxObj2D::AddForce(glm::dvec2 _a) {
-	a+=_a/mass;
+	if(store){
+		Wake();
+		store->ax[body] += _a.x/store->mass[body];
+		store->ay[body] += _a.y/store->mass[body];
+	}
+	else a+=_a/mass;
+}
+
+PhyxObj2D*		PhyxObj2D::ParentBody(){
+	if(parent!=castParent){ //attached to something else since the last call
+		castParent = parent;
+		parentBody = dynamic_cast<PhyxObj2D*>(parent);
+	}
+	return parentBody;
 }
 
 glm::dvec2		PhyxObj2D::V(){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
+		auto p = ParentBody();
 		if(p) return p->V();
-		else return v;
 	}
-	else return v;
+	return store? glm::dvec2(store->vx[body],store->vy[body]) : v;
 }
 void			PhyxObj2D::V(glm::dvec2 _v){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
+		auto p = ParentBody();
 		if(p) p->V(_v);
 	}
+	else if(store){
+		Wake();
+		store->vx[body]=_v.x;
+		store->vy[body]=_v.y;
+	}
 	else v=_v;
 }
 void			PhyxObj2D::dV(glm::dvec2 _v){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
+		auto p = ParentBody();
 		if(p) p->dV(_v);
 	}
+	else if(store){
+		Wake();
+		store->vx[body]+=_v.x;
+		store->vy[body]+=_v.y;
+	}
 	else v+=_v;
 }
-float const 	PhyxObj2D::XV(){
+void			PhyxObj2D::Kick(glm::dvec2 _v){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
-		if(p) return p->XV();
-		else return v.x;
+		auto p = ParentBody();
+		if(p) p->Kick(_v);
+	}
+	else if(store){
+		store->vx[body]+=_v.x;
+		store->vy[body]+=_v.y;
 	}
-	else return v.x;
+	else v+=_v;
 }
+float const 	PhyxObj2D::XV(){return V().x;}
 void 			PhyxObj2D::XV(float _xv){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
+		auto p = ParentBody();
 		if(p) p->XV(_xv);
 	}
-	else v.x=_xv;
-}
-float const 	PhyxObj2D::YV(){
-	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
-		if(p) return p->YV();
-		else return v.y;
+	else if(store){
+		Wake();
+		store->vx[body]=_xv;
 	}
-	else return v.y;
+	else v.x=_xv;
 }
+float const 	PhyxObj2D::YV(){return V().y;}
 void 			PhyxObj2D::YV(float _yv){
 	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
+		auto p = ParentBody();
 		if(p) p->YV(_yv);
 	}
+	else if(store){
+		Wake();
+		store->vy[body]=_yv;
+	}
 	else v.y=_yv;
 }
-float 			PhyxObj2D::Speed(){
-	if(parent) {
-		auto p = dynamic_cast<PhyxObj2D*>(parent);
-		if(p) return p->Speed();
-		else return glm::length(v);
-	}
-	else return glm::length(v);
-}
\ No newline at end of file
+float 			PhyxObj2D::Speed(){return glm::length(V());}
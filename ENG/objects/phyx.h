@@ -7,6 +7,35 @@
 
 #include "gameobj.h"
 #include "kldr.h"
+#include "qtree.h"
+#include "gravity.h"
+#include "ecs.h"
+enum BodyFlags {
+	BODY_KINEMATIC = 1,
+	BODY_ATTACHED = 2, //has a parent and moves with it, refreshed every step
+	BODY_ASLEEP = 4 //resting, not integrated until woken
+};
+
+/**
+Rigid body store
+state of the bodies managed by a PhyxENG, one packed array per field
+so the step loops stream contiguous memory
+**/
+struct RigidBodies {
+	std::vector<double> x, y; //world position, gathered from the GameObjs every step
+	std::vector<double> vx, vy;
+	std::vector<double> ax, ay;
+	std::vector<double> mass;
+	std::vector<unsigned char> flags;
+	std::vector<int> idle; //steps spent below the sleep thresholds
+	std::vector<double> restAx, restAy; //acceleration a sleeper fell asleep under, held by its contacts
+
+	int Add(glm::dvec2 v, glm::dvec2 a, double m, unsigned char f);
+	void Clear();
+	int Size() const {return mass.size();}
+	void Remove(int i); //the last body takes slot i
+};
+
 class PhyxObj2D : virtual public GameObj, public CollisionObj
 {
 public:
@@ -32,25 +61,29 @@ public:
 	glm::dvec2		V();
 	void			V(glm::dvec2 _v);
 	void			dV(glm::dvec2 _v);
+	void			Kick(glm::dvec2 _v); //dV from the solver, doesn't wake
 	float const 	XV();
 	void 			XV(float _xv);
 	float const 	YV();
 	void 			YV(float _yv);
 	float 			Speed();
+	PhyxObj2D*		ParentBody(); //parent as a PhyxObj2D or null, cast once per parent
 
-	glm::dvec2		A(){return a;}
-	float const 	XA()		{return a.x;}
-	void 			XA(float _xa){a.x=_xa;}
-	float const 	YA()		{return a.y;}
-	void 			YA(float _ya){a.y=_ya;}
+	glm::dvec2		A(){return store? glm::dvec2(store->ax[body],store->ay[body]) : a;}
+	float const 	XA()		{return A().x;}
+	void 			XA(float _xa){if(store) store->ax[body]=_xa; else a.x=_xa;}
+	float const 	YA()		{return A().y;}
+	void 			YA(float _ya){if(store) store->ay[body]=_ya; else a.y=_ya;}
 
 
-	float const 	Mass()		{return mass;}
-	void 			Mass(double _m){mass=_m;}
+	double const 	Mass()		{return store? store->mass[body] : mass;}
+	void 			Mass(double _m){if(store) store->mass[body]=_m; else mass=_m;}
 	//*/
 
-	bool const 		isKinematic() {return kinematic;}
-	void 	 		isKinematic(bool b) {kinematic=b;}
+	bool const 		isKinematic() {return store? (store->flags[body]&BODY_KINEMATIC) : kinematic;}
+	void 	 		isKinematic(bool b);
+	bool const 		isAsleep() {return store && (store->flags[body]&BODY_ASLEEP);}
+	void 			Wake(); //forces and velocity changes wake the body too
 
 	bool Orbiting(PhyxObj2D* other){
 		for(auto po : orbiting) if(po==other) return true;
@@ -59,7 +92,17 @@ public:
 
 	std::vector<PhyxObj2D*> orbiting;
 
+	GameObj * castParent = nullptr; //parent when parentBody was cast
+	PhyxObj2D * parentBody = nullptr; //velocities of attached bodies are their parent's
+
+	//handle into the PhyxENG store once managed
+	RigidBodies * store = nullptr;
+	int body = -1;
+	void Bind(RigidBodies*); //moves the state below into the store
+	void Unbind(); //and back
+
 //	glm::dvec2 pos2D; //now directly use gameObejct stuff
+	//state until managed by a PhyxENG, use the accessors
 	glm::dvec2 v;
 	glm::dvec2 a;
 	//double xv,yv; //velocity
@@ -82,6 +125,37 @@ enum GravityMode {
 	None
 };
 
+enum Integrator {
+	SemiImplicitEuler,	//v then x, one gravity evaluation per step
+	VelocityVerlet,		//leapfrog kick-drift-kick, two evaluations, keeps orbits closed
+	RungeKutta4			//four evaluations, most accurate per step
+};
+
+enum GravitySolver {
+	Pairwise,	//exact, every couple of bodies
+	BarnesHut	//quadtree approximation, only used in Everything mode
+};
+
+
+/**
+Contact handed to the solver, impulses are along the normal only
+**/
+struct SolverContact {
+	PhyxObj2D *p, *q;
+	Collider *cp, *cq; //the colliders that touched, a body may touch another with several
+	Contact contact; //from the narrow phase
+	double invMassP, invMassQ; //0 for kinematic and sleeping bodies
+	double normalMass; //1/(invMassP+invMassQ)
+	double target; //normal velocity wanted once solved, the bounce
+	double impulse; //accumulated, warm started from the last step
+};
+
+struct CachedImpulse {
+	Collider *a, *b; //a<b, each contact of a couple of bodies keeps its own
+	double impulse;
+	bool operator<(const CachedImpulse& o) const {return a<o.a || (a==o.a && b<o.b);}
+	bool operator==(const CachedImpulse& o) const {return a==o.a && b==o.b;}
+};
 
 class PhyxENG {
 public:
@@ -89,16 +163,39 @@ public:
 	PhyxENG(){t = std::chrono::steady_clock::now();}
 
 	void Init(std::vector<GameObj*>*,CollisionENG *,SoundENG*);
-	void Update();
+	void Init(Registry&,CollisionENG *,SoundENG*); //bodies of the RigidBody2D components
+	void Link(CollisionENG *,SoundENG*); //after managed changed, init the collisions first
+	void Add(PhyxObj2D*); //add it to the collision engine first
+	void Remove(PhyxObj2D*); //the last body takes its slot
+	void Relink(int collId, PhyxObj2D*); //body now at collId, null if none, after CollisionENG::Remove
+	void Index(PhyxObj2D*); //its RigidBody2D follows it in the store
+	void Update(); //one step of the frame time, or as many fixed steps as it holds
+	void Step(double); //gravity, collision resolution and integration
+	void ApplyGravity(); //accumulates gravity on managed objects, in Update
+	void Gather(); //copies world positions into the store
+	void Integrate(double); //steps the store and writes positions back
+	void EulerStep(double); //store only, see Integrator
+	void VerletStep(double);
+	void RK4Step(double);
+	void UpdateSleep(); //puts resting bodies to sleep, counts active ones
+	void ContinuousCollisions(double); //after Integrate, replays the step of the couples that crossed
+	int GatherContacts(); //solver contacts from this frame's events
+	void SolveContacts(double); //sequential impulses, then pushes the overlaps out
+	double WarmImpulse(Collider*, Collider*); //impulse of the couple last step, 0 if they weren't touching
+	void ApplyImpulse(SolverContact&, double); //without waking, resting contacts get impulses every step
 
 //Physics Collisions
-	void StaticResolution(Collider *, Collider *);
-	void StaticResolution(PhyxObj2D*, Collider *,PhyxObj2D*, Collider *); //uses weight in resolution and checks for kinematics
-	void DynamicResolution(PhyxObj2D*, Collider *,PhyxObj2D*, Collider *);
+	//the contact comes from the narrow phase, nothing is measured again
+	void StaticResolution(Collider *, Collider *, const Contact&);
+	void StaticResolution(PhyxObj2D*, PhyxObj2D*, const Contact&); //uses weight in resolution and checks for kinematics
+	void DynamicResolution(PhyxObj2D*, PhyxObj2D*, const Contact&);
 
 	//built in functions
 // 	glm::vec3 Gravity();//Gravity3D()
  	glm::dvec2 Gravity2D(PhyxObj2D *,PhyxObj2D*);
+ 	void GravityAt(const double *x, const double *y, double *gx, double *gy); //Everything mode acceleration of the free bodies, 0 otherwise
+ 	void TreeGravity(const double *x, const double *y, double *gx, double *gy); //Barnes-Hut version
+ 	void PairwiseGravity(const double *x, const double *y, double *gx, double *gy); //exact version, through GravityKernel
 
 // 	glm::vec3 Drag();
 // 	glm::vec2 Drag2D();
@@ -110,13 +207,52 @@ public:
  	SoundENG * soundENG;
  	CollisionENG * collisionENG;
  	std::vector<PhyxObj2D *> managed;
+ 	RigidBodies bodies; //state of managed, same order
+ 	std::vector<PhyxObj2D *> byCollId; //managed bodies, at their CollisionObj::collId
+ 	Pool<RigidBody2D> * components = nullptr; //the registry's once initialised from it, their index follows the store
 	std::chrono::time_point
 		<std::chrono::steady_clock> t;	
-	int PHYX_LAYER=0;
+	LayerMask layers = ~0u; //collider layers it resolves, trigger layers never are
 	bool clipping=true;
+	int solverIterations=8; //passes over the contacts, more settles piles faster
+	bool warmStarting=true; //contacts start from the impulse of the last step
+	double slop=.01; //overlap left alone so resting contacts last from step to step
+	double correction=.8; //share of the rest of the overlap pushed out per step
+	double bounceSpeed=.05; //slower approaches don't bounce, lets piles come to rest
+	bool ccd=true; //fast bodies are swept so they can't tunnel through others
+	double ccdThreshold=.5; //bounding radii per step, slower bodies are left to the discrete test
 	double timescale=1;
+	bool fixedstep=false; //steps of fixed length instead of one step per frame
+	double step=1./120.; //fixed step length, in scaled seconds
+	int maxSubsteps=8; //steps per frame at most, time beyond is dropped
+	double accumulator=0; //time not simulated yet
+	double alpha=1; //how far between the last two steps the frame is, for RenderObj::Draw
 	float G = 1.0E-5;
 	GravityMode gravitymode = Everything;
+	GravitySolver gravitysolver = Pairwise;
+	Integrator integrator = SemiImplicitEuler;
+	bool sleeping=true; //resting bodies stop being integrated and tested against each other
+	double sleepSpeed=.01, sleepAccel=.01; //below both for sleepSteps steps is resting
+	int sleepSteps=60;
+	int active=0; //bodies awake after the last step
+	double theta = .5; //Barnes-Hut opening angle, 0 is exact
+	QuadTree qtree;
+	SimdLevel simd = DetectSimd(); //instruction set of the pairwise kernel
+	JobSystem * jobs = nullptr; //gravity runs on it when set
+	std::vector<double> gravMass; //reused every step by PairwiseGravity
+	std::vector<double> gravAx, gravAy; //gravity part of the store accelerations
+	std::vector<double> stageX, stageY, stageAx, stageAy; //integrator scratch
+	std::vector<double> kx, ky, kvx, kvy, sumX, sumY, sumVx, sumVy;
+	std::vector<int> treeBodies; //reused every step by TreeGravity
+	std::vector<glm::dvec2> treePos;
+	std::vector<double> treeMass;
+	std::vector<double> startX, startY; //store positions before Integrate, for the sweep
+	std::vector<glm::dvec2> sweepMotion; //by collId
+	std::vector<CollisionMsg> impacts;
+	std::vector<char> swept; //by body, one replay each per step
+	std::vector<SolverContact> contacts;
+	std::vector<CachedImpulse> warm, warmNext; //impulses of the last step, sorted
+	std::vector<char> supported; //by body, a contact pushed it this step, it can rest under a load
 	double colEl = .9; //collisionElasticity
 	double fps=0; int framecounter=0; double timecounter=0;
 
@@ -0,0 +1,17 @@
+#include "pool.h"
+
+int Arena::NextTypeId(){
+	static int next = 0;
+	return next++;
+}
+
+void Arena::Clear(){
+	// later pools may hold objects made for the earlier ones (meshes of asteroids...)
+	for(int i=order.size()-1;i>=0;i--) pools[order[i]]->Clear();
+}
+
+int Arena::Live() const {
+	int n = 0;
+	for(int id : order) n += pools[id]->Live();
+	return n;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "gameobj.h"
+
+/**
+Handle to a pooled object
+stays valid while the object lives, Get returns null once it was deleted
+even if its slot was reused since
+**/
+template <typename T>
+struct Handle {
+	int index = -1;
+	unsigned int gen = 0;
+	bool operator==(const Handle& o) const {return index==o.index && gen==o.gen;}
+};
+
+class ObjectPoolBase {
+public:
+	virtual ~ObjectPoolBase()=default;
+	virtual void Clear()=0;
+	virtual int Live() const=0;
+};
+
+/**
+Typed pool allocator
+objects are built in fixed size blocks that never move, freed slots are reused first
+so spawning and destroying the same kind of object doesn't touch the heap
+**/
+template <typename T>
+class ObjectPool : public ObjectPoolBase {
+public:
+	static const int BLOCK = 64; //objects per block
+
+	~ObjectPool(){Clear();}
+
+	template <typename... A> T* New(A&&... args){
+		if(freeSlot<0) Grow();
+		int i = freeSlot;
+		Slot& s = At(i);
+		freeSlot = s.next;
+		T* obj = new (s.storage) T(std::forward<A>(args)...);
+		s.used = true;
+		live++;
+		return obj;
+	}
+	void Delete(T* obj){
+		if(!obj) return;
+		Slot* s = reinterpret_cast<Slot*>(obj);
+		if(!s->used) return; //deleted twice, the slot may be on the free list already
+		obj->~T();
+		s->used = false;
+		s->gen++;
+		s->next = freeSlot;
+		freeSlot = s->index;
+		live--;
+	}
+	Handle<T> HandleOf(T* obj) const {
+		const Slot* s = reinterpret_cast<const Slot*>(obj);
+		Handle<T> h;
+		h.index = s->index;
+		h.gen = s->gen;
+		return h;
+	}
+	T* Get(Handle<T> h){
+		if(h.index<0 || h.index>=(int)blocks.size()*BLOCK) return nullptr;
+		Slot& s = At(h.index);
+		return (s.used && s.gen==h.gen)? reinterpret_cast<T*>(s.storage) : nullptr;
+	}
+	void Clear() override { //deletes every live object, keeps the blocks
+		for(int i=0;i<(int)blocks.size()*BLOCK;i++)
+			if(At(i).used) Delete(reinterpret_cast<T*>(At(i).storage));
+	}
+	int Live() const override {return live;}
+
+//private:
+	struct Slot {
+		alignas(T) unsigned char storage[sizeof(T)]; //first, a T* is its Slot*
+		int index;
+		int next; //free list
+		unsigned int gen = 0;
+		bool used = false;
+	};
+	std::vector<std::unique_ptr<Slot[]>> blocks;
+	int freeSlot = -1;
+	int live = 0;
+
+	Slot& At(int i) {return blocks[i/BLOCK][i%BLOCK];}
+	void Grow(){
+		int first = blocks.size()*BLOCK;
+		blocks.emplace_back(new Slot[BLOCK]);
+		for(int i=BLOCK-1;i>=0;i--){ //lowest slots handed out first
+			Slot& s = blocks.back()[i];
+			s.index = first+i;
+			s.next = freeSlot;
+			freeSlot = s.index;
+		}
+	}
+};
+
+/**
+Arena, one per level
+owns a pool per type of what the level creates, Clear tears the whole level down at once
+GameObjs it creates remember it and allocate their colliders and meshes from it too
+unregister them from the engines (Game::Despawn) before clearing
+**/
+class Arena {
+public:
+	~Arena(){Clear();}
+
+	template <typename T, typename... A> T* New(A&&... args){
+		T* obj = Pool<T>().New(std::forward<A>(args)...);
+		if constexpr (std::is_base_of<GameObj,T>::value) obj->arena = this;
+		return obj;
+	}
+	template <typename T> void Delete(T* obj) {Pool<T>().Delete(obj);}
+	template <typename T> Handle<T> HandleOf(T* obj) {return Pool<T>().HandleOf(obj);}
+	template <typename T> T* Get(Handle<T> h) {return Pool<T>().Get(h);}
+	void Clear(); //every object of every pool, latest pools first
+	int Live() const;
+
+	template <typename T> ObjectPool<T>& Pool(){
+		int id = TypeId<T>();
+		if(id>=(int)pools.size()) pools.resize(id+1);
+		if(!pools[id]){
+			pools[id].reset(new ObjectPool<T>());
+			order.push_back(id);
+		}
+		return *static_cast<ObjectPool<T>*>(pools[id].get());
+	}
+
+//private:
+	std::vector<std::unique_ptr<ObjectPoolBase>> pools; //by TypeId
+	std::vector<int> order; //pools in creation order
+
+	static int NextTypeId();
+	template <typename T> static int TypeId(){
+		static int id = NextTypeId();
+		return id;
+	}
+};
@@ -0,0 +1,120 @@
+#include "qtree.h"
+#include <cmath>
+
+void QuadTree::Build(const std::vector<glm::dvec2>& p, const std::vector<double>& m){
+	pos = &p;
+	mass = &m;
+	nodes.clear();
+	next.assign(p.size(),-1);
+	if(p.empty()) return;
+
+	glm::dvec2 lo = p[0], hi = p[0];
+	for(auto& x : p){
+		lo = glm::min(lo,x);
+		hi = glm::max(hi,x);
+	}
+	double half = glm::max(hi.x-lo.x,hi.y-lo.y)*.5;
+	NewNode((lo+hi)*.5, half*1.001 + 1e-9);
+
+	for(int b=0;b<(int)p.size();b++) Insert(0,b,0);
+	Summarize(0);
+}
+
+int QuadTree::NewNode(glm::dvec2 center, double half){
+	QuadNode n;
+	n.center = center;
+	n.half = half;
+	n.com = center;
+	n.mass = 0;
+	n.child = -1;
+	n.body = -1;
+	nodes.push_back(n);
+	return nodes.size()-1;
+}
+
+int QuadTree::Quadrant(int node, glm::dvec2 p) const {
+	return (p.x >= nodes[node].center.x) | ((p.y >= nodes[node].center.y)<<1);
+}
+
+void QuadTree::Subdivide(int node){
+	glm::dvec2 c = nodes[node].center;
+	double h = nodes[node].half*.5;
+	int first = NewNode(c+glm::dvec2(-h,-h),h); //push_back, don't hold refs across these
+	NewNode(c+glm::dvec2( h,-h),h);
+	NewNode(c+glm::dvec2(-h, h),h);
+	NewNode(c+glm::dvec2( h, h),h);
+	nodes[node].child = first;
+}
+
+void QuadTree::Insert(int node, int b, int depth){
+	while(true){
+		if(nodes[node].child<0){
+			if(nodes[node].body<0){
+				nodes[node].body = b;
+				return;
+			}
+			if(depth>=MAX_DEPTH){ //coincident bodies, stack them
+				next[b] = nodes[node].body;
+				nodes[node].body = b;
+				return;
+			}
+			int old = nodes[node].body;
+			nodes[node].body = -1;
+			Subdivide(node);
+			nodes[nodes[node].child + Quadrant(node,(*pos)[old])].body = old;
+		}
+		node = nodes[node].child + Quadrant(node,(*pos)[b]);
+		depth++;
+	}
+}
+
+void QuadTree::Summarize(int node){
+	glm::dvec2 weighted(0);
+	double m = 0;
+	if(nodes[node].child<0){
+		for(int b=nodes[node].body;b>=0;b=next[b]){
+			weighted += (*pos)[b]*(*mass)[b];
+			m += (*mass)[b];
+		}
+	} else for(int c=0;c<4;c++){
+		int ch = nodes[node].child+c;
+		Summarize(ch);
+		weighted += nodes[ch].com*nodes[ch].mass;
+		m += nodes[ch].mass;
+	}
+	nodes[node].mass = m;
+	if(m>0) nodes[node].com = weighted/m;
+}
+
+glm::dvec2 QuadTree::Acceleration(int i, double theta, double G) const {
+	glm::dvec2 p = (*pos)[i];
+	glm::dvec2 acc(0);
+	if(nodes.empty()) return acc;
+
+	int stack[4*MAX_DEPTH+4]; //each level pops one cell and pushes four
+	int top = 0;
+	stack[top++] = 0;
+	while(top){
+		const QuadNode& n = nodes[stack[--top]];
+		if(n.mass<=0) continue;
+		if(n.child<0){
+			for(int b=n.body;b>=0;b=next[b]){
+				if(b==i) continue;
+				glm::dvec2 d = (*pos)[b] - p;
+				double r2 = glm::dot(d,d);
+				if(r2>0) acc += d*((*mass)[b]/r2);
+			}
+			continue;
+		}
+		glm::dvec2 d = n.com - p;
+		double r2 = glm::dot(d,d);
+		bool inside = std::abs(p.x-n.center.x)<=n.half && std::abs(p.y-n.center.y)<=n.half;
+		if(!inside && 4.*n.half*n.half < theta*theta*r2){ //cell width / distance < theta
+			acc += d*(n.mass/r2);
+			continue;
+		}
+		for(int c=0;c<4;c++) stack[top++] = n.child+c;
+	}
+	//same law as PhyxENG::Gravity2D : a2b * G*Mm / (d*d/4)
+	return acc*(4.*G);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "ENG/includes/glm/glm.hpp"
+#include <vector>
+
+/**
+Barnes-Hut quadtree
+rebuilt every step over the 2D positions of the bodies,
+each cell keeps the total mass and center of mass of what it contains
+**/
+struct QuadNode {
+	glm::dvec2 center;	// center of the cell
+	double half;		// half width of the cell
+	glm::dvec2 com;		// center of mass
+	double mass;
+	int child;			// first of 4 consecutive children, -1 for leaves
+	int body;			// first body of a leaf, chained through QuadTree::next
+};
+
+class QuadTree {
+public:
+	static const int MAX_DEPTH = 48; //past this, bodies are stacked in the same leaf
+
+	std::vector<QuadNode> nodes;
+	std::vector<int> next; //body chain inside leaves, -1 terminated
+
+	void Build(const std::vector<glm::dvec2>& pos, const std::vector<double>& mass);
+	// acceleration felt by body i, cells seen under an angle < theta are taken as one mass
+	glm::dvec2 Acceleration(int i, double theta, double G) const;
+
+//private:
+	const std::vector<glm::dvec2> * pos = nullptr;
+	const std::vector<double> * mass = nullptr;
+
+	int NewNode(glm::dvec2 center, double half);
+	void Insert(int node, int b, int depth);
+	void Subdivide(int node);
+	int Quadrant(int node, glm::dvec2 p) const;
+	void Summarize(int node);
+};
@@ -19,7 +19,7 @@ public:
 	Model model;
 
 	void loadModel(std::string path);
-	void Draw(Shader* shader);
+	void Draw(Shader* shader); // with the worldMatrix of the last Game::UpdateTransforms
 };
 
 
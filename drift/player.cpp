@@ -15,9 +15,9 @@ void Player::inputCallback(GLFWwindow* window)
 	if (game->cameraMode == ORTCAM_MODE)
 	{
 		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)		{ AddForce(glm::vec2(Direction.x, Direction.z)); }
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)		{ rotation.y += 1.0f; }
+		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)		{ Rotation(rotation + glm::dvec3(0, 1.0, 0)); }
 		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)		{ AddForce(-glm::vec2(Direction.x, Direction.z)); }
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)		{ rotation.y -= 1.0f; }
+		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)		{ Rotation(rotation - glm::dvec3(0, 1.0, 0)); }
 	}
 
 	Direction.x = sin(glm::radians(rotation.y));
@@ -33,7 +33,8 @@ void Asteroid::Generate(std::vector<Texture>* textures)
 
 	layerVertices = layers[maxLayer-1];
 
-	this->meshes.push_back(new Mesh(layerVertices, core.indices, *textures)); // making the mesh to be the last layer
+	// making the mesh to be the last layer, from the level arena when the asteroid comes from one
+	this->meshes.push_back(arena ? arena->New<Mesh>(layerVertices, core.indices, *textures) : new Mesh(layerVertices, core.indices, *textures));
 
 	// fill the active layer with the last layer's vertices, storing the corresponding layer number into each asteroidVertex
 	AsteroidVertex astVertex;
@@ -69,14 +70,30 @@ void Asteroid::Break(unsigned int indice, GLFWwindow* window)
 	this->size = getMeanSize(); // updating the mean size
 	this->lifePoints--; // decreasing lifepoints
 
-	if(this->lifePoints <= 0) // if lifepoints go to zero
+	if(this->lifePoints <= 0 && this->life == LIFE_ACTIVE) // if lifepoints go to zero
 	{
 		Game* game = static_cast<Game*>(glfwGetWindowUserPointer(window));
-		this->position.y -= 1000.0f; // the asteroid is moved far away, this way of making it disappear can be improved
+		game->Despawn(this); // out of the physics and collisions at the end of the frame, then recycled
 		game->soundENG.Play(4, false); // playing the breaking asteroid sound effect
 	}
 
-	this->meshes[0] = new Mesh(vertices, this->meshes[0]->indices, this->meshes[0]->textures); // replacing the active mesh
+	// replacing the active mesh, the old one is given back so breaking doesn't leak
+	Mesh* old = this->meshes[0];
+	this->meshes[0] = arena ? arena->New<Mesh>(vertices, old->indices, old->textures) : new Mesh(vertices, old->indices, old->textures);
+	if (arena) arena->Delete(old);
+	else delete old;
+}
+
+// give the mesh and the collider back, once the asteroid is recycled
+void Asteroid::Release()
+{
+	for (auto mesh : this->meshes)
+	{
+		if (arena) arena->Delete(mesh);
+		else delete mesh;
+	}
+	this->meshes.clear();
+	ReleaseColliders();
 }
 
 float Asteroid::getMeanSize()
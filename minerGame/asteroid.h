@@ -8,6 +8,7 @@
 #include "ENG/objects/kldr.h"
 #include "ENG/objects/ctrl.h"
 #include "ENG/objects/rndr.h"
+#include "ENG/objects/pool.h"
 #include "ENG/objects/perlin.h"
 #include "ENG/includes/poisson_disk_sampling/poisson_disk_sampling.h"
 
@@ -39,7 +40,8 @@ public:
 	Asteroid();
 	// asteroid functions
 	void Generate(std::vector<Texture>* textures);
-	void Break(unsigned int indice, GLFWwindow* window); // break a given point
+	void Break(unsigned int indice, GLFWwindow* window); // break a given point, despawning the asteroid at 0 lifePoints
+	void Release(); // free the mesh and the collider of a recycled asteroid
 	float getMeanSize(); // returns a size based on the mean length of its radiuses
 	// gui function
 	void gui(GLFWwindow*);
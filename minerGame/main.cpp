@@ -24,6 +24,12 @@ std::vector<Asteroid*> asteroids; // pointers to our asteroids
 std::vector<glm::vec3> asteroidsPositions; // used to store our generated asteroid positions
 unsigned int nbAsteroids;
 
+// collision layers, what meets what is set in main
+const int ASTEROID_LAYER = 0;
+const int SHIELD_LAYER = 1;
+const int SHIP_LAYER = 2;
+const double TARGET_RANGE = 10.0; // how far an asteroid can be targeted without touching it
+
 int main(int argc, char **argv)
 {
 	srand(time(NULL)); // initializing rand() seed with time
@@ -57,12 +63,15 @@ int main(int argc, char **argv)
 	miningGame.gameobjects.push_back(shield);
 	for (unsigned int i = 0; i < nbAsteroids; i++)
 	{
-		asteroids.push_back(new Asteroid());
+		asteroids.push_back(miningGame.level.New<Asteroid>()); // the level arena owns them, their collider and mesh
 		miningGame.gameobjects.push_back(asteroids[i]);
 	}
 
 	// initialize the openGL context and the game engine
 	GLFWwindow* window = miningGame.Initialize();
+	miningGame.collENG.Interact(SHIELD_LAYER, ASTEROID_LAYER); // asteroids hit the shield, they hit each other already as every layer meets itself
+	miningGame.collENG.Interact(SHIELD_LAYER, SHIELD_LAYER, false); // there's only one shield
+	miningGame.collENG.Interact(SHIP_LAYER, ASTEROID_LAYER); // what gets through the shield hits the hull
 
 	// creating our used textures
 	// --------------------------
@@ -112,14 +121,17 @@ int main(int argc, char **argv)
 	// ---------------------------------------------------------
 	// player
 	player->name="player"; // giving our object a name, used in debug
-	player->scale = glm::vec3(0.001f); // scaling the player model, as the ship model is way too big
+	player->Scale(glm::dvec3(0.001)); // scaling the player model, as the ship model is way too big
 	player->MoveTo(glm::vec2(-5.0f, -5.0f)); // moving our player to a location
 	player->Mass(1.0f); // setting our player mass, it changes its reaction to collisions
+	std::vector<Vertex> shipVertices; // every mesh of the ship model, the hull wraps them all
+	for (auto mesh : player->meshes) shipVertices.insert(shipVertices.end(), mesh->vertices.begin(), mesh->vertices.end());
+	player->CreateHullCollider(shipVertices, SHIP_LAYER, 0.001); // a polygon collider seen from above, scaled like the model, it turns with the ship
 	// shield
 	shield->name="shield";
 	shield->attach(player); // linking the shield to player, making it his parent
-	shield->scale = glm::vec3(shield->size);
-	shield->CreateCollider(glm::dvec3(0.0f), 0, shield->size); // create a circle collider, with no offset, at layer 0 and sized like the shield
+	shield->Scale(glm::dvec3(shield->size));
+	shield->CreateCollider(glm::dvec3(0.0f), SHIELD_LAYER, shield->size); // create a circle collider, with no offset, on the shield layer and sized like the shield
 	// asteroids
 	for (unsigned int i = 0; i < nbAsteroids; i++)
 	{
@@ -128,7 +140,7 @@ int main(int argc, char **argv)
 
 		asteroids[i]->name="asteroid"+std::to_string(i);
 		asteroids[i]->MoveTo(pos);
-		asteroids[i]->CreateCollider(glm::dvec3(0), 0, asteroids[i]->size * 0.9f);
+		asteroids[i]->CreateCollider(glm::dvec3(0), ASTEROID_LAYER, asteroids[i]->size * 0.9f);
 		asteroids[i]->Mass(100.0f * asteroids[i]->size);
 		asteroids[i]->YV(0.5f); // giving our asteroids a starting Y speed, making them move slowly together
 	}
@@ -152,6 +164,7 @@ int main(int argc, char **argv)
 		miningGame.collENG.Update();
 		miningGame.inputENG.Update(window);
 		miningGame.phyxENG.Update();
+		miningGame.UpdateTransforms(); // drawing matrices of this frame
 
 		// render
 		// ------
@@ -187,20 +200,22 @@ int main(int argc, char **argv)
 
 		// draw textured objects here
 		// --------------------------
-		for (unsigned int i = 0; i < nbAsteroids; i++)
+		for (unsigned int i = 0; i < asteroids.size(); i++)
 		{
 			asteroids[i]->Draw(miningGame.textureShader); // draw our asteroid using the textureShader
-			asteroids[i]->UpdateCollider(glm::vec3(0), 0, asteroids[i]->size * 0.9f, 0); // we update the asteroid collider to its actual size
+			asteroids[i]->UpdateCollider(glm::vec3(0), ASTEROID_LAYER, asteroids[i]->size * 0.9f, 0); // we update the asteroid collider to its actual size
 		}
 
 		// we get the collisions informations that concerns the player from the collision engine
-		std::vector<CollisionMsg*> playerCollisions = miningGame.collENG.CollisionsWith(shield, 0);
+		// the view reads the engine events in place, it is valid until the next collENG.Update()
+		CollisionView playerCollisions = miningGame.collENG.CollisionsWith(shield, SHIELD_LAYER);
 		// for each of this collision
 		for (unsigned int i = 0; i < playerCollisions.size(); i++)
 		{
 			shield->startAnimation(window); // ask the shield to start animating
-			Asteroid* qAst = dynamic_cast<Asteroid*>(playerCollisions[i]->Q.first); // we cast the second actor to see if it's an asteroid
-			if(qAst) // if it's an asteroid
+			GameObj* other = (playerCollisions[i].P.first == shield) ? playerCollisions[i].Q.first : playerCollisions[i].P.first; // the shield may be either actor
+			Asteroid* qAst = dynamic_cast<Asteroid*>(other); // we cast the other actor to see if it's an asteroid
+			if(qAst && qAst->life == LIFE_ACTIVE) // if it's an asteroid, and not one destroyed this frame
 			{
 				unsigned j = 0;
 				while (j<10) // find 10 points to break from it
@@ -213,8 +228,25 @@ int main(int argc, char **argv)
 						j++;
 					}
 				}
-				player->target = qAst; // changing the player target to be the asteroid collisioned with
-				if (player->target->lifePoints <= 0)	{ player->target = nullptr; } // if the asteroid is destroyed, the player has no target anymore
+				player->target = miningGame.level.HandleOf(qAst); // changing the player target to be the asteroid collisioned with
+				if (qAst->lifePoints <= 0)	{ player->target = Handle<Asteroid>(); } // if the asteroid is destroyed, the player has no target anymore
+			}
+		}
+		// without a target, the nearest asteroid in range becomes one
+		// the collision engine finds it in its tree instead of us looping over every asteroid
+		if (!miningGame.level.Get(player->target))
+		{
+			CollisionObj* nearest[4]; // our buffers for the query, nothing is allocated
+			double distances[4];
+			int found = miningGame.collENG.KNearest(player->worldPosition2D(), 4, nearest, distances, 1u << ASTEROID_LAYER, TARGET_RANGE);
+			for (int i = 0; i < found; i++)
+			{
+				Asteroid* candidate = dynamic_cast<Asteroid*>(nearest[i]);
+				if (candidate && candidate->life == LIFE_ACTIVE) // asteroids destroyed this frame are still in the engine until EndFrame
+				{
+					player->target = miningGame.level.HandleOf(candidate);
+					break;
+				}
 			}
 		}
 		shield->Update(window); // updating the shield to draw if it's animated and check if the animation sould end or not (based on time)
@@ -233,7 +265,7 @@ int main(int argc, char **argv)
 		// draw untextured objects here
 		// ----------------------------
 		player->Draw(miningGame.materialShader);
-		player->camera.updateCameraVectors(player->worldPosition()); // updating our player orthogonal camera position every frame
+		player->camera.updateCameraVectors(player->DrawPosition()); // updating our player orthogonal camera position every frame
 
 		// draw skybox at last
 		// -------------------
@@ -255,8 +287,8 @@ int main(int argc, char **argv)
 		if (miningGame.cameraMode == ORTCAM_MODE)
 		{
 			player->gui(window);
-			if(player->target)
-				player->target->gui(window);
+			if(Asteroid* target = miningGame.level.Get(player->target)) // null once its asteroid was recycled
+				target->gui(window);
 			if(shield->animation.isAnimating)
 				shield->gui(window);
 		}
@@ -272,8 +304,24 @@ int main(int argc, char **argv)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		miningGame.EndFrame(); // despawned objects leave the engines
+
+		// recycled asteroids leave the draw list, their memory goes back to the level arena for the next ones
+		for (unsigned int i = 0; i < asteroids.size();)
+		{
+			if (asteroids[i]->life == LIFE_RECYCLED)
+			{
+				asteroids[i]->Release();
+				miningGame.level.Delete(asteroids[i]);
+				asteroids[i] = asteroids.back();
+				asteroids.pop_back();
+			}
+			else i++;
+		}
 	}
 
+	miningGame.ClearLevel(); // every asteroid with its collider and mesh, at once
+	asteroids.clear();
 	miningGame.Terminate();
 
 	// glfw: terminate, clearing all previously allocated GLFW resources
@@ -3,7 +3,7 @@
 
 // Player
 // ------
-Player::Player(): thrusting(false), target(nullptr), score(0)
+Player::Player(): thrusting(false), target(), score(0)
 {
 	// initialize player's direction based on its rotation
 	Direction.x = sin(glm::radians(rotation.y));
@@ -21,9 +21,9 @@ void Player::inputCallback(GLFWwindow* window)
 	if (game->cameraMode == ORTCAM_MODE)
 	{
 		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)	{ AddForce(glm::dvec2(Direction.x, Direction.z)*2.); }
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)	{ rotation.y += 1.3f; }
+		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)	{ Rotation(rotation + glm::dvec3(0, 1.3, 0)); }
 		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)	{ AddForce(-glm::dvec2(Direction.x, Direction.z)); }
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)	{ rotation.y -= 1.3f; }
+		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)	{ Rotation(rotation - glm::dvec3(0, 1.3, 0)); }
 		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)	{ AddForce(glm::dvec2(-Direction.z, Direction.x)); }
 		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)	{ AddForce(glm::dvec2(Direction.z, -Direction.x)); }
 	}
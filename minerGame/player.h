@@ -11,6 +11,7 @@
 #include "ENG/objects/kldr.h"
 #include "ENG/objects/ctrl.h"
 #include "ENG/objects/rndr.h"
+#include "ENG/objects/pool.h"
 
 #include <locale> // used to format the score with imbue (10000 -> 10,000)
 
@@ -25,7 +26,7 @@ class Player : public PhyxObj2D, public InputObj, public RenderObj
 public:
 	CamOrt camera; // orthogonal camera
 	glm::vec3 Direction; // directionnal vector
-	Asteroid* target; // the targeted asteroid
+	Handle<Asteroid> target; // the targeted asteroid, resolve it with the level arena, it is null once the asteroid is recycled
 	bool thrusting; // if the player's thrusters are active or not
 	int score; // player's score
 
@@ -27,6 +27,8 @@ SimpleBody * C = new SimpleBody();
 int main(int argc, char **argv)
 {
 	sandBox.phyxENG.gravitymode = Everything;
+	sandBox.phyxENG.integrator = VelocityVerlet; // keeps the orbits closed at larger time scales
+	sandBox.collENG.broadphase = Tree; // suns and moons are too different in size for one grid cell
 	sandBox.soundENG.soundFiles.push_back(sandBox.soundsPath + "track0.ogg");
 	sandBox.soundENG.soundFiles.push_back(sandBox.soundsPath + "bleep.ogg");
 	sandBox.soundENG.soundFiles.push_back(sandBox.soundsPath + "solid.ogg");
@@ -94,7 +96,7 @@ int main(int argc, char **argv)
 	// initializing the player
 	// -----------------------
 /*	player->worldPosition = glm::vec3(15.0f, 0.0f, 0.0f);
-	player->scale = glm::vec3(0.001f);
+	player->Scale(glm::dvec3(0.001));
 	player->Init();
 	//player->loadModel(modelsPath + "sputnik/sputnik1.obj");
 	player->YV(2); // starting velocity
@@ -143,13 +145,14 @@ int main(int argc, char **argv)
 		sandBox.collENG.Update();
 		sandBox.inputENG.Update(window);
 		sandBox.phyxENG.Update();
+		sandBox.UpdateTransforms(); // drawing matrices of this frame
 
-/*		for(auto e : sandBox.collENG.events)		
+/*		for(auto& e : sandBox.collENG.events)		
 			std::cout
-				<< "collision event \t" << e << std::endl  
-				<< "life \t" << e->life << "layer \t" << e->layer << std::endl
-				<< "Pname \t" << e->P.first->name << std::endl
-				<< "Qname \t" << e->Q.first->name << std::endl;
+				<< "collision event \t" << &e << std::endl  
+				<< "life \t" << e.life << "layer \t" << e.layer << std::endl
+				<< "Pname \t" << e.P.first->name << std::endl
+				<< "Qname \t" << e.Q.first->name << std::endl;
 //*/
 
 		// render
@@ -220,6 +223,7 @@ int main(int argc, char **argv)
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		sandBox.EndFrame(); // despawned objects leave the engines
 	}
 
 	sandBox.Terminate();
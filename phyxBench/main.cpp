@@ -0,0 +1,477 @@
+// physics benchmark, runs the engines without a window
+// usage: ./phyxBench.exe [max bodies]
+// ------------------------------------------------------
+#include "ENG/objects/phyx.h"
+#include "ENG/objects/kldr.h"
+#include "ENG/objects/jobs.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+JobSystem jobs;
+
+// times fn, repeating it until at least half a second went by
+template <typename F>
+double timeIt(F fn, int& reps)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::milli> d(0);
+	reps = 0;
+	do {
+		fn();
+		reps++;
+		d = std::chrono::steady_clock::now() - start;
+	} while (d.count() < 500.);
+	return d.count() / reps;
+}
+
+// scatters n bodies on a disc, keeping roughly the same density whatever n is
+void makeBodies(unsigned int n, std::vector<GameObj*>& gameobjects)
+{
+	srand(42);
+	double radius = 10.*sqrt((double)n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		PhyxObj2D* body = new PhyxObj2D();
+		double r = radius*sqrt(rand()/(double)RAND_MAX);
+		double t = 6.28318530717*rand()/(double)RAND_MAX;
+		body->MoveTo(glm::dvec2(r*cos(t), r*sin(t)));
+		body->Mass(1. + 9.*rand()/(double)RAND_MAX);
+		gameobjects.push_back(body);
+	}
+}
+
+void gravityBench(unsigned int n)
+{
+	std::vector<GameObj*> gameobjects;
+	makeBodies(n, gameobjects);
+	CollisionENG collENG;
+	PhyxENG phyxENG;
+	phyxENG.Init(&gameobjects, &collENG, nullptr);
+	phyxENG.gravitymode = Everything;
+
+	auto step = [&]() {
+		phyxENG.ApplyGravity();
+		for (auto p : phyxENG.managed) p->ResetA();
+	};
+
+	// exact accelerations, used as reference for the tree
+	// a single step is already long enough to be timed past a few thousand bodies
+	int reps;
+	phyxENG.gravitysolver = Pairwise;
+	auto start = std::chrono::steady_clock::now();
+	phyxENG.ApplyGravity();
+	std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+	std::vector<glm::dvec2> exact;
+	for (auto p : phyxENG.managed) { exact.push_back(p->A()); p->ResetA(); }
+	double pairwiseMs = (d.count() < 500.) ? timeIt(step, reps) : d.count();
+	std::cout << std::setw(8) << n << "  pairwise            " << std::setw(12) << pairwiseMs << " ms/step" << std::endl;
+
+	for (double theta : {0.3, 0.5, 0.8})
+	{
+		phyxENG.gravitysolver = BarnesHut;
+		phyxENG.theta = theta;
+		double treeMs = timeIt(step, reps);
+
+		phyxENG.ApplyGravity();
+		double err = 0, ref = 0;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			glm::dvec2 a = phyxENG.managed[i]->A();
+			err += glm::dot(a - exact[i], a - exact[i]);
+			ref += glm::dot(exact[i], exact[i]);
+			phyxENG.managed[i]->ResetA();
+		}
+		std::cout << std::setw(8) << n << "  barnes-hut theta=" << std::setw(3) << theta
+			<< std::setw(12) << treeMs << " ms/step"
+			<< "  x" << std::setw(8) << pairwiseMs / treeMs
+			<< "  rms error " << sqrt(err / ref) << std::endl;
+	}
+
+	for (auto go : gameobjects) delete go;
+}
+
+// pairwise kernel against the per object path PhyxENG used before the packed store
+void kernelBench(unsigned int n)
+{
+	std::vector<GameObj*> gameobjects;
+	makeBodies(n, gameobjects);
+	CollisionENG collENG;
+	PhyxENG phyxENG;
+	phyxENG.Init(&gameobjects, &collENG, nullptr);
+	phyxENG.gravitymode = Everything;
+	phyxENG.gravitysolver = Pairwise;
+	double pairs = n*(n-1.)/2.;
+
+	int reps;
+	double legacyMs = timeIt([&]() {
+		for (unsigned int i = 0; i < n; i++)
+			for (unsigned int j = i+1; j < n; j++)
+			{
+				PhyxObj2D* p = phyxENG.managed[i];
+				PhyxObj2D* q = phyxENG.managed[j];
+				glm::dvec2 g = phyxENG.Gravity2D(p, q);
+				p->AddForce(g);
+				q->AddForce(-g);
+			}
+		for (auto p : phyxENG.managed) p->ResetA();
+	}, reps);
+	std::cout << std::setw(8) << n << "  Gravity2D per pair " << std::setw(12) << pairs/legacyMs*1000. << " pairs/s" << std::endl;
+
+	for (int l = SIMD_SCALAR; l <= DetectSimd(); l++)
+	{
+		phyxENG.simd = (SimdLevel)l;
+		double ms = timeIt([&]() {
+			phyxENG.ApplyGravity();
+			for (auto p : phyxENG.managed) p->ResetA();
+		}, reps);
+		std::cout << std::setw(8) << n << "  kernel " << std::setw(11) << SimdName((SimdLevel)l) << " " << std::setw(12) << pairs/ms*1000. << " pairs/s"
+			<< "  x" << std::setw(8) << legacyMs / ms << std::endl;
+	}
+
+	// same kernel split across the job system, results must not depend on the thread count
+	phyxENG.ApplyGravity();
+	std::vector<glm::dvec2> serial;
+	for (auto p : phyxENG.managed) { serial.push_back(p->A()); p->ResetA(); }
+	phyxENG.jobs = &jobs;
+	double threadedMs = timeIt([&]() {
+		phyxENG.ApplyGravity();
+		for (auto p : phyxENG.managed) p->ResetA();
+	}, reps);
+	phyxENG.ApplyGravity();
+	bool same = true;
+	for (unsigned int i = 0; i < n; i++) same = same && phyxENG.managed[i]->A() == serial[i];
+	std::cout << std::setw(8) << n << "  kernel " << std::setw(3) << jobs.Workers()+1 << " threads " << std::setw(12) << pairs/threadedMs*1000. << " pairs/s"
+		<< "  x" << std::setw(8) << legacyMs / threadedMs << (same ? "" : "  RESULT MISMATCH") << std::endl;
+
+	for (auto go : gameobjects) delete go;
+}
+
+// asteroid field, like minerGame, with a collider on every body
+void collisionBench(unsigned int n)
+{
+	std::vector<GameObj*> gameobjects;
+	makeBodies(n, gameobjects);
+	for (auto go : gameobjects)
+	{
+		PhyxObj2D* body = dynamic_cast<PhyxObj2D*>(go);
+		body->CreateCollider(glm::dvec3(0), 0, 2.f + 3.f*rand()/RAND_MAX);
+	}
+	CollisionENG collENG;
+	collENG.Init(&gameobjects);
+
+	// brute force takes minutes past 10k bodies, it is only run to check and compare the grid
+	int reps;
+	bool brute = (n <= 10000);
+	double bruteMs = 0;
+	size_t bruteEvents = 0;
+	if (brute)
+	{
+		collENG.broadphase = BruteForce;
+		bruteMs = timeIt([&]() { collENG.Update(); }, reps);
+		bruteEvents = collENG.events.size();
+		std::cout << std::setw(8) << n << "  brute force " << std::setw(12) << bruteMs << " ms/frame" << std::endl;
+	}
+	collENG.broadphase = Grid;
+	double gridMs = timeIt([&]() { collENG.Update(); }, reps);
+	std::cout << std::setw(8) << n << "  grid        " << std::setw(12) << gridMs << " ms/frame";
+	if (brute) std::cout << "  x" << std::setw(8) << bruteMs / gridMs;
+	std::cout << "  culled " << collENG.pairsCulled << "/" << collENG.pairsTotal;
+	if (brute && collENG.events.size() != bruteEvents) std::cout << "  EVENT MISMATCH";
+	std::cout << std::endl;
+
+	// threaded narrow phase has to report the same events in the same order
+	std::vector<std::pair<int,int>> serial;
+	for (auto& e : collENG.events) serial.push_back(std::make_pair(e.pid, e.qid));
+	collENG.jobs = &jobs;
+	double threadedMs = timeIt([&]() { collENG.Update(); }, reps);
+	bool same = (serial.size() == collENG.events.size());
+	for (size_t i = 0; same && i < serial.size(); i++)
+		same = (serial[i] == std::make_pair(collENG.events[i].pid, collENG.events[i].qid));
+	std::cout << std::setw(8) << n << "  grid " << std::setw(3) << jobs.Workers()+1 << " threads" << std::setw(12) << threadedMs << " ms/frame"
+		<< "  x" << std::setw(8) << gridMs / threadedMs << (same ? "" : "  EVENT MISMATCH") << std::endl;
+
+	// the tree keeps its nodes and couples between frames, the first update builds it, bodies resting here cost it nothing more
+	collENG.jobs = nullptr;
+	collENG.broadphase = Tree;
+	collENG.Update();
+	double treeMs = timeIt([&]() { collENG.Update(); }, reps);
+	std::cout << std::setw(8) << n << "  aabb tree   " << std::setw(12) << treeMs << " ms/frame"
+		<< "  x" << std::setw(8) << gridMs / treeMs << "  height " << collENG.tree.Height()
+		<< ((collENG.events.size() != serial.size()) ? "  EVENT MISMATCH" : "") << std::endl;
+
+	// continuous collisions of one fast body crossing the field, its candidates come from the tree
+	std::vector<glm::dvec2> motion(gameobjects.size(), glm::dvec2(0));
+	motion[0] = glm::dvec2(50., 0.);
+	std::vector<CollisionMsg> impacts;
+	double sweepMs = timeIt([&]() { collENG.Sweep(motion, 1., impacts); }, reps);
+	std::cout << std::setw(8) << n << "  sweep 1 fast" << std::setw(12) << sweepMs << " ms/frame  impacts " << impacts.size() << std::endl;
+
+	for (auto go : gameobjects) delete go;
+}
+
+// two r=1 circles thrown at each other, fast enough to cross in a step, they have to bounce back
+void tunnellingCheck()
+{
+	for (double speed : {700., 4000.})
+	{
+		std::vector<GameObj*> gameobjects;
+		PhyxObj2D* a = new PhyxObj2D();
+		PhyxObj2D* b = new PhyxObj2D();
+		a->MoveTo(glm::dvec2(-5., 0.));
+		b->MoveTo(glm::dvec2(5., 0.));
+		for (auto body : {a, b})
+		{
+			body->CreateCollider(glm::dvec3(0), 0, 1.f);
+			gameobjects.push_back(body);
+		}
+		a->V(glm::dvec2(speed, 0.));
+		b->V(glm::dvec2(-speed, 0.));
+		CollisionENG collENG;
+		PhyxENG phyxENG;
+		collENG.Init(&gameobjects);
+		phyxENG.Init(&gameobjects, &collENG, nullptr);
+		phyxENG.gravitymode = None;
+		phyxENG.colEl = 1;
+		for (int i = 0; i < 10; i++)
+		{
+			collENG.Update();
+			phyxENG.Step(.01);
+		}
+		std::cout << std::setw(8) << speed << "  speed  a x " << std::setw(10) << a->X() << "  b x " << std::setw(10) << b->X()
+			<< ((a->X() < b->X()) ? "" : "  TUNNELLED") << std::endl;
+		for (auto go : gameobjects) delete go;
+	}
+}
+
+// spatial queries right after a Remove and an Add, before any Update, must see every object where it is
+void removeQueryCheck()
+{
+	std::vector<GameObj*> gameobjects;
+	makeBodies(1000, gameobjects);
+	for (auto go : gameobjects) dynamic_cast<PhyxObj2D*>(go)->CreateCollider(glm::dvec3(0), 0, 2.f);
+	CollisionENG collENG;
+	collENG.Init(&gameobjects);
+	collENG.broadphase = Tree;
+	collENG.Update();
+	PhyxObj2D* removed = dynamic_cast<PhyxObj2D*>(gameobjects[10]);
+	PhyxObj2D* moved = dynamic_cast<PhyxObj2D*>(gameobjects.back()); // takes the removed one's collId
+	collENG.Remove(removed);
+	PhyxObj2D* added = new PhyxObj2D(); // gets the collId the moved one had
+	added->MoveTo(glm::dvec2(1e5, 0.));
+	added->CreateCollider(glm::dvec3(0), 0, 2.f);
+	gameobjects.push_back(added);
+	collENG.Add(added);
+	bool ok = true;
+	CollisionObj* out[16];
+	double distances[16];
+	int found = collENG.OverlapCircle(removed->worldPosition2D(), .1, out, 16);
+	for (int i = 0; i < found; i++) ok = ok && out[i] != removed;
+	found = collENG.OverlapCircle(added->worldPosition2D(), .1, out, 16);
+	ok = ok && found == 1 && out[0] == added;
+	found = collENG.KNearest(moved->worldPosition2D(), 1, out, distances);
+	ok = ok && found == 1 && out[0] == moved && distances[0] == 0.;
+	RayHit hits[16];
+	glm::dvec2 at = moved->worldPosition2D();
+	found = collENG.Raycast(at - glm::dvec2(10., 0.), at + glm::dvec2(10., 0.), hits, 16);
+	bool hitMoved = false;
+	for (int i = 0; i < found; i++)
+	{
+		ok = ok && hits[i].obj != removed;
+		hitMoved = hitMoved || hits[i].obj == moved;
+	}
+	ok = ok && hitMoved;
+	std::cout << "  queries after a remove and an add" << (ok ? "" : "  STALE TREE") << std::endl;
+	for (auto go : gameobjects) delete go;
+}
+
+// one SAT case, a against b, checked against the overlap and normal worked out by hand
+void satCase(const char* name, PhyxObj2D* a, PhyxObj2D* b, bool hit, glm::dvec2 normal, double penetration)
+{
+	Contact c;
+	bool found = CollisionENG::ConvexCollision(a->colliders[0], b->colliders[0], c);
+	bool ok = (found == hit) && (!hit || (glm::length(c.normal - normal) < 1e-6 && std::abs(c.penetration - penetration) < 1e-6));
+	std::cout << "  " << std::left << std::setw(34) << name << std::right << (found ? "  hit" : "  miss");
+	auto tidy = [](double v) { return (std::abs(v) < 1e-9) ? 0. : v; }; // no -0 or 6e-17 left by the turns
+	if (found) std::cout << "  normal " << std::setw(10) << tidy(c.normal.x) << std::setw(10) << tidy(c.normal.y) << "  overlap " << std::setw(10) << c.penetration;
+	std::cout << (ok ? "" : "  SHAPE MISMATCH") << std::endl;
+}
+
+// polygons and capsules, still and turned by their object's yaw
+void satCheck()
+{
+	std::vector<GameObj*> gameobjects;
+	auto body = [&](double x, double y, double yaw) {
+		PhyxObj2D* b = new PhyxObj2D();
+		b->MoveTo(glm::dvec2(x, y));
+		b->Rotation(glm::dvec3(0., yaw, 0.));
+		gameobjects.push_back(b);
+		return b;
+	};
+	std::vector<glm::dvec2> square = {{-1., -1.}, {1., -1.}, {1., 1.}, {-1., 1.}};
+	PhyxObj2D* box = body(0., 0., 0.);
+	box->CreatePolygonCollider(glm::dvec3(0), 0, square);
+	PhyxObj2D* side = body(1.5, .2, 0.);
+	side->CreatePolygonCollider(glm::dvec3(0), 0, square);
+	PhyxObj2D* turned = body(2.3, 0., 45.); // a corner now points at the box, sqrt(2) from its center
+	turned->CreatePolygonCollider(glm::dvec3(0), 0, square);
+	PhyxObj2D* apart = body(2.5, 0., 0.);
+	apart->CreatePolygonCollider(glm::dvec3(0), 0, square);
+	PhyxObj2D* ball = body(1., 1.2, 0.);
+	ball->CreateCollider(glm::dvec3(0), 0, 1.f);
+	PhyxObj2D* capsule = body(0., 0., 0.);
+	capsule->CreateCapsuleCollider(glm::dvec3(0), 0, glm::dvec2(-2., 0.), glm::dvec2(2., 0.), .5);
+	PhyxObj2D* upright = body(0., 0., 90.); // its segment now runs along y
+	upright->CreateCapsuleCollider(glm::dvec3(0), 0, glm::dvec2(-2., 0.), glm::dvec2(2., 0.), .5);
+	PhyxObj2D* below = body(0., -4.5, 0.);
+	below->CreatePolygonCollider(glm::dvec3(0), 0, square);
+	PhyxObj2D* offset = body(0., 0., 90.); // its square sits 3 along x, the turn takes it to (0, -3)
+	offset->CreatePolygonCollider(glm::dvec3(3., 0., 0.), 0, square);
+	PhyxObj2D* carrier = body(0., 0., 90.);
+	PhyxObj2D* carried = new PhyxObj2D(); // turned by its parent only
+	carried->attach(carrier);
+	carried->Position(glm::dvec3(0., 0., 1.2));
+	carried->CreateCapsuleCollider(glm::dvec3(0), 0, glm::dvec2(-2., 0.), glm::dvec2(2., 0.), .5);
+	gameobjects.push_back(carried);
+
+	satCase("square / square", side, box, true, glm::dvec2(1., 0.), .5);
+	satCase("square / square 45 deg", turned, box, true, glm::dvec2(1., 0.), sqrt(2.) - 1.3);
+	satCase("square / square apart", apart, box, false, glm::dvec2(0.), 0.);
+	satCase("circle / capsule", ball, capsule, true, glm::dvec2(0., 1.), .3);
+	satCase("circle / capsule 90 deg", ball, upright, true, glm::dvec2(1., 0.), .5);
+	satCase("offset square 90 deg / square", offset, below, true, glm::dvec2(0., 1.), .5);
+	satCase("circle / capsule, 90 deg parent", ball, carried, true, glm::dvec2(1., 0.), .5);
+	std::cout << "  " << std::left << std::setw(34) << "offset square bound" << std::right << "  radius " << std::setw(10) << offset->boundRadius;
+	double reach = 0; // to the farthest corner of the turned square
+	for (auto& p : square) reach = std::max(reach, glm::length(glm::dvec2(0., -3.) + p - offset->BoundCenter()));
+	std::cout << ((reach <= offset->boundRadius + 1e-9) ? "" : "  BOUND MISMATCH") << std::endl;
+	for (auto go : gameobjects) delete go;
+}
+
+// six r=1 circles stacked on a kinematic floor under a steady push down, they have to come to rest without sinking into each other
+void stackCheck(int iterations, bool warm)
+{
+	std::vector<GameObj*> gameobjects;
+	std::vector<PhyxObj2D*> stack;
+	PhyxObj2D* floor = new PhyxObj2D();
+	floor->MoveTo(glm::dvec2(0., -100.));
+	floor->CreateCollider(glm::dvec3(0), 0, 100.f);
+	floor->Mass(1000.);
+	floor->isKinematic(true);
+	gameobjects.push_back(floor);
+	for (int i = 0; i < 6; i++)
+	{
+		PhyxObj2D* body = new PhyxObj2D();
+		body->MoveTo(glm::dvec2(0., 1. + 2.05*i));
+		body->CreateCollider(glm::dvec3(0), 0, 1.f);
+		gameobjects.push_back(body);
+		stack.push_back(body);
+	}
+	CollisionENG collENG;
+	PhyxENG phyxENG;
+	collENG.Init(&gameobjects);
+	phyxENG.Init(&gameobjects, &collENG, nullptr);
+	phyxENG.gravitymode = None;
+	phyxENG.solverIterations = iterations;
+	phyxENG.warmStarting = warm;
+	phyxENG.sleeping = false;
+	int settled = -1;
+	double speed = 0;
+	for (int s = 0; s < 600; s++)
+	{
+		for (auto body : stack) body->AddForce(glm::dvec2(0., -10.));
+		collENG.Update();
+		phyxENG.Step(1./60.);
+		speed = 0;
+		for (auto body : stack) speed += body->Speed();
+		if (speed >= 0.05) settled = -1;
+		else if (settled < 0) settled = s;
+	}
+	double overlap = 0;
+	for (int i = 0; i + 1 < 6; i++) overlap = glm::max(overlap, 2. - (stack[i+1]->Y() - stack[i]->Y()));
+	std::cout << std::setw(8) << iterations << "  iterations" << (warm ? "  warm" : "      ") << "  resting from step " << std::setw(4) << settled
+		<< "  sum |v| " << std::setw(10) << speed << "  max overlap " << std::setw(10) << overlap
+		<< ((warm && (settled < 0 || overlap > 0.1)) ? "  UNSETTLED" : "") << std::endl; // cold starts are only there to compare
+	for (auto go : gameobjects) delete go;
+}
+
+// the same stack resting on a kinematic planet under its gravity, with sleeping on it has to fall asleep and stay so
+// the contacts hold it up every step, neither their impulses nor the gravity it is held against may wake it
+void sleepCheck()
+{
+	std::vector<GameObj*> gameobjects;
+	std::vector<PhyxObj2D*> stack;
+	PhyxObj2D* planet = new PhyxObj2D();
+	planet->MoveTo(glm::dvec2(0., -100.));
+	planet->CreateCollider(glm::dvec3(0), 0, 100.f);
+	planet->Mass(1e7);
+	planet->isKinematic(true);
+	gameobjects.push_back(planet);
+	for (int i = 0; i < 6; i++)
+	{
+		PhyxObj2D* body = new PhyxObj2D();
+		body->MoveTo(glm::dvec2(0., 1. + 2.05*i));
+		body->CreateCollider(glm::dvec3(0), 0, 1.f);
+		gameobjects.push_back(body);
+		stack.push_back(body);
+	}
+	CollisionENG collENG;
+	PhyxENG phyxENG;
+	collENG.Init(&gameobjects);
+	phyxENG.Init(&gameobjects, &collENG, nullptr);
+	phyxENG.gravitymode = Everything;
+	phyxENG.solverIterations = 8;
+	int asleep = -1;
+	double top = 0;
+	for (int s = 0; s < 900; s++)
+	{
+		collENG.Update();
+		phyxENG.Step(1./60.);
+		bool all = true;
+		for (auto body : stack) all = all && body->isAsleep();
+		if (!all) asleep = -1;
+		else if (asleep < 0) asleep = s;
+		if (s == 600) top = stack.back()->Y();
+	}
+	double drift = std::abs(stack.back()->Y() - top);
+	double speed = 0; // sleepers keep no velocity, warm impulses don't reach them
+	for (auto body : stack) speed += body->Speed();
+	std::cout << std::setw(8) << stack.size() << "  bodies on a planet  asleep from step " << std::setw(4) << asleep
+		<< "  awake " << phyxENG.active << "  sum |v| " << std::setw(10) << speed << "  top drift " << std::setw(10) << drift
+		<< ((asleep < 0 || drift > 1e-3 || speed > 0.) ? "  AWAKE" : "") << std::endl;
+	for (auto go : gameobjects) delete go;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int maxBodies = (argc > 1) ? atoi(argv[1]) : 100000;
+
+	std::cout << "gravity (Everything mode)" << std::endl;
+	for (unsigned int n : {1000u, 10000u, 100000u})
+		if (n <= maxBodies) gravityBench(n);
+
+	std::cout << "pairwise gravity kernel" << std::endl;
+	for (unsigned int n : {1000u, 10000u})
+		if (n <= maxBodies) kernelBench(n);
+
+	std::cout << "collisions" << std::endl;
+	for (unsigned int n : {1000u, 10000u, 100000u})
+		if (n <= maxBodies) collisionBench(n);
+
+	std::cout << "continuous collisions" << std::endl;
+	tunnellingCheck();
+
+	std::cout << "spatial queries" << std::endl;
+	removeQueryCheck();
+
+	std::cout << "separating axes" << std::endl;
+	satCheck();
+
+	std::cout << "contact solver, stack of 6" << std::endl;
+	for (int iterations : {1, 8})
+		for (bool warm : {false, true}) stackCheck(iterations, warm);
+	sleepCheck();
+	return 0;
+}